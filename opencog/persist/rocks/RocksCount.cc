@@ -0,0 +1,386 @@
+/*
+ * RocksCount.cc
+ * Counters kept up to date as Atoms are stored.
+ *
+ * Copyright (c) 2022 Linas Vepstas <linas@linas.org>
+ *
+ * LICENSE:
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/write_batch.h"
+
+#include <opencog/atoms/base/Node.h>
+#include <opencog/atoms/value/FloatValue.h>
+#include <opencog/persist/sexpr/Sexpr.h>
+
+#include "RocksStorage.h"
+#include "RocksUtils.h"
+
+using namespace opencog;
+
+// ======================================================================
+// Counting the records under some prefix requires scanning all of
+// them, which gets slow, when there are millions. Instead, keep
+// counters that are updated as records are added. These are kept in
+// `c@` records, holding a signed decimal integer. Updates are done
+// with a RocksDB merge, so that the old count never has to be read.
+//
+// What does have to be read is the record being counted, to find out
+// if it is new (or, when deleting, if it is still there). This is
+// done under the lock for the Atom it belongs to (see sidLock()), and
+// the merges go into the same WriteBatch as the record itself, so
+// that a crash cannot leave the counters out of step.
+//
+// The frame counters are
+//    `c@fid:a` -- the number of Atoms in frame fid (the o@ records).
+//    `c@fid:v` -- the number of Values in frame fid (the k@ records,
+//                 not counting the `+1` and `-1` markers).
+//
+// The global counters are
+//    `C@a@`, `C@n@`, `C@l@`, `C@f@`, `C@i@`, `C@h@` -- the number of
+//                 records having that prefix.
+//    `C@k@`    -- the number of Values, in all frames. Like the frame
+//                 counters, this does not count markers.
+//    `C@zN@`   -- the number of Links of height N.
+//    `C@t:TYPE` -- the number of Atoms of type TYPE.
+//
+// The incoming-set sizes are
+//    `I@sid:`      -- the number of Links holding the Atom sid.
+//    `I@sid:TYPE`  -- the number of Links of type TYPE holding sid.
+//
+// The same merge operator is also used for Values (the `k@` records),
+// when updateValue() is given a numeric delta, and the `merge-values`
+// URI option is set. The delta is a FloatValue; it is added to the
+// stored FloatValue, element by element. The marginals (the `M@`
+// records, see RocksMarginal.cc) are updated the same way.
+
+/// Add the FloatValue `sdelta` to the FloatValue `sval`. The result
+/// has the type of `sval`. If either one is not a FloatValue, the
+/// delta replaces the old Value, as if it had been written with Put.
+static std::string addFloats(const std::string& sval,
+                             const std::string& sdelta)
+{
+	FloatValuePtr fv, dv;
+	try
+	{
+		size_t pos = 0;
+		fv = FloatValueCast(Sexpr::decode_value(sval, pos));
+		pos = 0;
+		dv = FloatValueCast(Sexpr::decode_value(sdelta, pos));
+	}
+	catch (...) {}
+	if (nullptr == fv or nullptr == dv) return sdelta;
+
+	std::vector<double> sum = fv->value();
+	const std::vector<double>& dlt = dv->value();
+	if (sum.size() < dlt.size()) sum.resize(dlt.size(), 0.0);
+	for (size_t i = 0; i < dlt.size(); i++) sum[i] += dlt[i];
+	return Sexpr::encode_value(createFloatValue(fv->get_type(), sum));
+}
+
+/// Add up counters. Both the stored value and the updates are signed
+/// decimal integers. Values are added with addFloats().
+class CountMerge : public rocksdb::AssociativeMergeOperator
+{
+	public:
+		virtual bool Merge(const rocksdb::Slice& key,
+		                   const rocksdb::Slice* existing_value,
+		                   const rocksdb::Slice& value,
+		                   std::string* new_value,
+		                   rocksdb::Logger* logger) const override
+		{
+			if (key.starts_with("k@") or key.starts_with("M@"))
+			{
+				if (existing_value)
+					*new_value = addFloats(existing_value->ToString(),
+						value.ToString());
+				else
+					*new_value = value.ToString();
+				return true;
+			}
+
+			int64_t sum = 0;
+			if (existing_value)
+				sum = std::stoll(existing_value->ToString());
+			sum += std::stoll(value.ToString());
+			*new_value = std::to_string(sum);
+			return true;
+		}
+
+		virtual const char* Name() const override
+		{
+			return "CountMerge";
+		}
+};
+
+/// The merge operator to use for this DB.
+std::shared_ptr<rocksdb::MergeOperator> RocksStorage::countMerger(void)
+{
+	return std::make_shared<CountMerge>();
+}
+
+/// Add `delta` to the counter `ckey`.
+void RocksStorage::addCount(const std::string& ckey, int64_t delta)
+{
+	_rfile->Merge(rocksdb::WriteOptions(), ckey, std::to_string(delta));
+}
+
+/// Add `delta` to the counter `ckey`, when `batch` is written.
+void RocksStorage::addCount(rocksdb::WriteBatch& batch,
+                            const std::string& ckey, int64_t delta)
+{
+	batch.Merge(ckey, std::to_string(delta));
+}
+
+/// Return the lock for the records of the Atom `sid`. The Atoms are
+/// spread over a fixed number of locks, so that writes to different
+/// Atoms seldom wait for one another.
+std::mutex& RocksStorage::sidLock(const std::string& sid)
+{
+	return _mtx_sids[std::hash<std::string>()(sid) % SID_LOCKS];
+}
+
+/// Take the locks for all of the Atoms in `sids`, for as long as
+/// `slcks` is kept. They are taken in order, so that two threads
+/// doing this cannot deadlock.
+void RocksStorage::lockSids(const std::set<std::string>& sids,
+                            std::vector<std::unique_lock<std::mutex>>& slcks)
+{
+	std::set<size_t> stripes;
+	for (const std::string& sid : sids)
+		stripes.insert(std::hash<std::string>()(sid) % SID_LOCKS);
+	for (size_t stripe : stripes)
+		slcks.emplace_back(_mtx_sids[stripe]);
+}
+
+/// Return the value of the counter `ckey`. Counters that were never
+/// set are zero.
+int64_t RocksStorage::getCount(const std::string& ckey)
+{
+	std::string sval;
+	rocksdb::Status s = _rfile->Get(rocksdb::ReadOptions(), ckey, &sval);
+	if (not s.ok()) return 0;
+	return std::stoll(sval);
+}
+
+/// Count the Atom `satom` as added (or removed, if `delta` is
+/// negative). The `satom` may have the hash in front of it.
+void RocksStorage::countAtom(const std::string& satom, bool is_node,
+                             int64_t delta)
+{
+	rocksdb::WriteBatch batch;
+	countAtom(batch, satom, is_node, delta);
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
+}
+
+/// As above, but when `batch` is written.
+void RocksStorage::countAtom(rocksdb::WriteBatch& batch,
+                             const std::string& satom, bool is_node,
+                             int64_t delta)
+{
+	size_t paren = satom.find('(');
+	size_t end = satom.find_first_of(" )", paren);
+	addCount(batch, "C@t:" + satom.substr(paren+1, end-paren-1), delta);
+	addCount(batch, "C@a@", delta);
+	addCount(batch, is_node ? "C@n@" : "C@l@", delta);
+}
+
+/// Count a Link as added to (or removed from, if `delta` is negative)
+/// the incoming set `ist`, which is of the form `i@sid:TYPE`. The
+/// counts change when `batch` is written.
+void RocksStorage::countIncoming(rocksdb::WriteBatch& batch,
+                                 const std::string& ist, int64_t delta)
+{
+	addCount(batch, "C@i@", delta);
+	addCount(batch, "I@" + ist.substr(2), delta);
+	addCount(batch, "I@" + ist.substr(2, ist.find(':') - 1), delta);
+}
+
+/// Recompute the incoming-set sizes, from scratch. This is needed
+/// only for DB's that were written before they were kept. The `i@`
+/// records are sorted by sid, so only one Atom is counted at a time.
+void RocksStorage::countIncomings(void)
+{
+	// Out with the old.
+	_rfile->DeleteRange(rocksdb::WriteOptions(), "I@", prefix_end("I@"));
+
+	std::string cur;
+	std::map<std::string, size_t> counts;
+	auto flush = [&]()
+	{
+		for (const auto& cpr : counts)
+			_rfile->Put(rocksdb::WriteOptions(), cpr.first,
+				std::to_string(cpr.second));
+		counts.clear();
+	};
+
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("i@"); it->Valid() and it->key().starts_with("i@"); it->Next())
+	{
+		// The key is of the form `i@ABC:ConceptNode-456`
+		const std::string& ist = it->key().ToString();
+		size_t colon = ist.find(':');
+		const std::string& sidc = ist.substr(2, colon-1);
+		if (sidc != cur)
+		{
+			flush();
+			cur = sidc;
+		}
+		counts["I@" + sidc] ++;
+		counts["I@" + ist.substr(2, ist.find('-', colon) - 2)] ++;
+	}
+	delete it;
+	flush();
+}
+
+/// Recompute the global counters, from scratch. This is needed
+/// only for DB's that were written before the counters were kept.
+void RocksStorage::countAll(void)
+{
+	// Out with the old.
+	_rfile->DeleteRange(rocksdb::WriteOptions(), "C@", prefix_end("C@"));
+
+	std::map<std::string, size_t> counts;
+	for (const char* pfx : {"a@", "n@", "l@", "f@", "i@", "h@"})
+		counts[std::string("C@") + pfx] = count_records(pfx);
+
+	// The Atom types.
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("a@"); it->Valid() and it->key().starts_with("a@"); it->Next())
+	{
+		const std::string& satom = it->value().ToString();
+		size_t paren = satom.find('(');
+		size_t end = satom.find_first_of(" )", paren);
+		counts["C@t:" + satom.substr(paren+1, end-paren-1)] ++;
+	}
+	delete it;
+
+	// The heights.
+	it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("z"); it->Valid() and it->key().starts_with("z"); it->Next())
+	{
+		const std::string& zkey = it->key().ToString();
+		counts["C@" + zkey.substr(0, zkey.find('@') + 1)] ++;
+	}
+	delete it;
+
+	// The Values. These might be in any column family.
+	std::vector<rocksdb::ColumnFamilyHandle*> cfhs;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_family);
+		for (const auto& fpr : _families)
+			cfhs.push_back(fpr.second);
+	}
+	size_t nvals = 0;
+	for (auto cfh : cfhs)
+	{
+		it = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+		for (it->Seek("k@"); it->Valid() and it->key().starts_with("k@"); it->Next())
+		{
+			const std::string& kkey = it->key().ToString();
+			char c = kkey[kkey.rfind(':') + 1];
+			if ('+' != c and '-' != c) nvals++;
+		}
+		delete it;
+	}
+	counts["C@k@"] = nvals;
+
+	for (const auto& cpr : counts)
+		_rfile->Put(rocksdb::WriteOptions(), cpr.first,
+			std::to_string(cpr.second));
+}
+
+/// Recompute the counters for all frames, from scratch. This is needed
+/// only for DB's that were written before the counters were kept.
+void RocksStorage::countFrames(void)
+{
+	// Out with the old.
+	_rfile->DeleteRange(rocksdb::WriteOptions(), "c@", prefix_end("c@"));
+
+	std::vector<std::string> fids;
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("d@"); it->Valid() and it->key().starts_with("d@"); it->Next())
+		fids.push_back(it->key().ToString().substr(2));
+	delete it;
+
+	for (const std::string& fid : fids)
+	{
+		std::string fidc = fid + ":";
+		std::vector<std::string> members;
+		getFrameMembers(fidc, members);
+
+		size_t nvals = 0;
+		FramePath path({{strtoaid(fid), Handle::UNDEFINED}});
+		for (const std::string& sid : members)
+		{
+			std::map<uint64_t, KeyVals> frame_keys;
+			getFrameKeys(sid, path, frame_keys);
+			for (const auto& fk : frame_keys)
+				for (const auto& kv : fk.second)
+					if ('+' != kv.first[0] and '-' != kv.first[0]) nvals++;
+		}
+
+		_rfile->Put(rocksdb::WriteOptions(), "c@" + fidc + "a",
+			std::to_string(members.size()));
+		_rfile->Put(rocksdb::WriteOptions(), "c@" + fidc + "v",
+			std::to_string(nvals));
+	}
+}
+
+// ======================================================================
+// User API
+
+/// Return the number of Atoms of exactly type `t` that are in storage,
+/// in any frame.
+size_t RocksStorage::countType(Type t)
+{
+	CHECK_OPEN;
+	const std::string& tname = nameserver().getTypeName(t);
+	if (_global_counts) return getCount("C@t:" + tname);
+
+	// An older DB, opened read-only. Do it the hard way.
+	std::string pfx = nameserver().isNode(t) ? "n@(" : "l@(";
+	return count_records(pfx + tname + " ");
+}
+
+/// Return the number of Links holding `h`, without loading any of
+/// them. All Links are counted, no matter what frame they are in.
+size_t RocksStorage::getIncomingSize(const Handle& h)
+{
+	CHECK_OPEN;
+	const std::string& sid = findAtom(h);
+	if (0 == sid.size()) return 0;
+	if (_incoming_counts) return getCount("I@" + sid + ":");
+	return count_records("i@" + sid + ":");
+}
+
+/// Return the number of Links of exactly type `t` holding `h`,
+/// without loading any of them.
+size_t RocksStorage::getIncomingSize(const Handle& h, Type t)
+{
+	CHECK_OPEN;
+	const std::string& sid = findAtom(h);
+	if (0 == sid.size()) return 0;
+	const std::string& ist = sid + ":" + nameserver().getTypeName(t);
+	if (_incoming_counts) return getCount("I@" + ist);
+	return count_records("i@" + ist + "-");
+}
+
+// ======================== THE END ======================
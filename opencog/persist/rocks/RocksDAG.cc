@@ -23,6 +23,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include "rocksdb/write_batch.h"
+
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/persist/sexpr/Sexpr.h>
 
@@ -40,7 +42,9 @@ using namespace opencog;
 /// It will have the form:
 ///    `(AtomSpace "space name" 42 55 66)`
 /// where the numbers are the string sid's of the outgoing set.
-std::string RocksStorage::encodeFrame(const Handle& hasp)
+/// If `create` is false, then sid's are not issued for the subframes;
+/// if some subframe is not yet in storage, the empty string is returned.
+std::string RocksStorage::encodeFrame(const Handle& hasp, bool create)
 {
 	// We should say `getTypeName()` as below, except that today,
 	// this will always be `AtomSpace`, 100% of the time. So the
@@ -53,29 +57,81 @@ std::string RocksStorage::encodeFrame(const Handle& hasp)
 	txt += ss.str();
 
 	for (const Handle& ho : hasp->getOutgoingSet())
-		txt += " " + writeFrame(ho);
+	{
+		std::string fid = create ? writeFrame(ho) : findFrame(ho);
+		if (0 == fid.size()) return "";
+		txt += " " + fid;
+	}
 
 	txt += ")";
 	return txt;
 }
 
-void RocksStorage::updateFrameMap(const Handle& hasp,
-                                  const std::string& sid)
+/// Make `ft` the current frame tables. Must be called with the
+/// frame lock held. The old tables are freed when the last reader
+/// lets go of them.
+void RocksStorage::publishFrames(std::shared_ptr<FrameTables>&& ft)
 {
-	std::lock_guard<std::mutex> flck(_mtx_frame);
-	_frame_map.insert({hasp, sid});
-	_fid_map.insert({sid, hasp});
+	std::atomic_store(&_frames, FrameTablesPtr(std::move(ft)));
+}
+
+/// Forget all frames. Must be called with the frame lock held.
+void RocksStorage::resetFrames(void)
+{
+	auto ft = std::make_shared<FrameTables>();
+	ft->generation = frameTables()->generation + 1;
+	publishFrames(std::move(ft));
+
+	// Let go of the AtomSpaces held in the cached paths.
+	for (PathShard& shard : _path_cache)
+	{
+		std::lock_guard<std::mutex> lck(shard.mtx);
+		shard.paths.clear();
+	}
+}
+
+/// Throw if `hasp` was merged into another frame by squashFrames().
+/// The frame it was merged into has to be loaded from the DB again.
+void RocksStorage::checkSquashed(const FrameTablesPtr& ft,
+                                 const Handle& hasp)
+{
+	if (ft->squashed.end() == ft->squashed.find(hasp)) return;
+	throw IOException(TRACE_INFO,
+		"The AtomSpace %s was squashed; load the frames again!\n",
+		hasp->get_name().c_str());
+}
+
+/// Add the `hasp`, `sid` pair to the tables `ft`, which are not yet
+/// published. Must be called with the frame lock held.
+void RocksStorage::insertFrame(FrameTables& ft, const Handle& hasp,
+                               const std::string& sid)
+{
+	ft.frame_map.insert({hasp, sid});
+	ft.fid_map.insert({sid, hasp});
 
-	// Clobber. Better safe than sorry.
-	_path_cache.clear();
+	// The cached paths remain valid. A path is never computed
+	// through a frame that isn't known; makeOrder() throws instead.
 
 	// Update the top-frame list, too. Returned by loadFrameDAG()
+	for (const Handle& ho : hasp->getOutgoingSet())
+		ft.top_frames.erase(ho);
+
+	bool is_top = true;
 	for (const Handle& hi : hasp->getIncomingSet())
 	{
-		if (_frame_map.end() != _frame_map.find(hi))
-			return;
+		if (ft.frame_map.end() != ft.frame_map.find(hi))
+		{ is_top = false; break; }
 	}
-	_top_frames.insert(hasp);
+	if (is_top) ft.top_frames.insert(hasp);
+}
+
+void RocksStorage::updateFrameMap(const Handle& hasp,
+                                  const std::string& sid)
+{
+	std::lock_guard<std::mutex> flck(_mtx_frame);
+	auto ft = std::make_shared<FrameTables>(*frameTables());
+	insertFrame(*ft, hasp, sid);
+	publishFrames(std::move(ft));
 }
 
 /// Search for the indicated AtomSpace, returning it's sid (string ID).
@@ -94,11 +150,13 @@ std::string RocksStorage::writeFrame(const Handle& hasp)
 	// Keep a map. This will be faster than the string conversion and
 	// string lookup. We expect this to be small, no larger than a few
 	// thousand entries, and so don't expect it to compete for RAM.
+	// No lock is needed to look at it.
 	{
-		std::lock_guard<std::mutex> flck(_mtx_frame);
-		auto it = _frame_map.find(hasp);
-		if (it != _frame_map.end())
+		FrameTablesPtr ft = frameTables();
+		auto it = ft->frame_map.find(hasp);
+		if (it != ft->frame_map.end())
 			return it->second;
+		checkSquashed(ft, hasp);
 	}
 
 	// std::string sframe = Sexpr::encode_frame(hasp);
@@ -132,12 +190,42 @@ std::string RocksStorage::writeFrame(const Handle& hasp)
 	// logger().debug("Frame sid=>>%s<< for >>%s<<", sid.c_str(), sframe.c_str());
 	_rfile->Put(rocksdb::WriteOptions(), "f@" + sframe, sid);
 	_rfile->Put(rocksdb::WriteOptions(), "d@" + sid, sframe);
+	addCount("C@f@", 1);
+
+	return sid;
+}
+
+/// Search for the indicated AtomSpace, returning it's sid (string ID).
+/// Unlike writeFrame(), this does not write anything; if the AtomSpace
+/// is not in storage, the empty string is returned. This resolves the
+/// AtomSpace and its subframes through the `f@` records, so only the
+/// frames actually asked about are ever looked up. There is no need to
+/// load the entire frame DAG first.
+std::string RocksStorage::findFrame(const Handle& hasp)
+{
+	if (nullptr == hasp) return "0";
+
+	{
+		FrameTablesPtr ft = frameTables();
+		auto it = ft->frame_map.find(hasp);
+		if (it != ft->frame_map.end())
+			return it->second;
+		checkSquashed(ft, hasp);
+	}
+
+	std::string sframe = encodeFrame(hasp, false);
+	if (0 == sframe.size()) return "";
 
+	std::string sid;
+	_rfile->Get(rocksdb::ReadOptions(), "f@" + sframe, &sid);
+	if (0 < sid.size())
+		updateFrameMap(hasp, sid);
 	return sid;
 }
 
-/// Decode the string encoding of the Frame
-Handle RocksStorage::decodeFrame(const std::string& senc)
+/// Decode the string encoding of the Frame. Subframes that are not
+/// yet known are looked up, and added to `ft`.
+Handle RocksStorage::decodeFrame(const std::string& senc, FrameTables& ft)
 {
 	if (0 != senc.compare(0, 12, "(AtomSpace \""))
 		throw IOException(TRACE_INFO, "Internal Error!");
@@ -153,7 +241,7 @@ Handle RocksStorage::decodeFrame(const std::string& senc)
 	{
 		pos++;
 		ros = senc.find_first_of(" )", pos);
-		oset.push_back(getFrame(senc.substr(pos, ros-pos)));
+		oset.push_back(getFrame(senc.substr(pos, ros-pos), ft));
 		pos = ros;
 	}
 	AtomSpacePtr asp = createAtomSpace(oset);
@@ -189,12 +277,30 @@ Handle RocksStorage::decodeFrame(const std::string& senc)
 Handle RocksStorage::getFrame(const std::string& fid)
 {
 	{
-		std::lock_guard<std::mutex> flck(_mtx_frame);
-		auto it = _fid_map.find(fid);
-		if (it != _fid_map.end())
+		FrameTablesPtr ft = frameTables();
+		auto it = ft->fid_map.find(fid);
+		if (it != ft->fid_map.end())
 			return it->second;
 	}
 
+	// The frame, and any of its subframes not yet seen, all go into
+	// one new copy of the tables.
+	std::lock_guard<std::mutex> flck(_mtx_frame);
+	auto ft = std::make_shared<FrameTables>(*frameTables());
+	Handle fas = getFrame(fid, *ft);
+	publishFrames(std::move(ft));
+	return fas;
+}
+
+/// Return the AtomSpacePtr corresponding to fid, decoding it, if it
+/// is not in `ft`, and adding it there. Must be called with the frame
+/// lock held.
+Handle RocksStorage::getFrame(const std::string& fid, FrameTables& ft)
+{
+	auto it = ft.fid_map.find(fid);
+	if (it != ft.fid_map.end())
+		return it->second;
+
 	std::string sframe;
 	_rfile->Get(rocksdb::ReadOptions(), "d@" + fid, &sframe);
 
@@ -203,8 +309,8 @@ Handle RocksStorage::getFrame(const std::string& fid)
 	// pointing to some AtomSpace in the environ of _atom_space.
 	// Handle asp = HandleCast(_atom_space);
 	// Handle fas = Sexpr::decode_frame(asp, sframe);
-	Handle fas = decodeFrame(sframe);
-	updateFrameMap(fas, fid);
+	Handle fas = decodeFrame(sframe, ft);
+	insertFrame(ft, fas, fid);
 	return fas;
 }
 
@@ -216,36 +322,47 @@ Handle RocksStorage::getFrame(const std::string& fid)
 /// This returns a list of all of the frames that are not subrames.
 /// This list is not used anywhere in the code here, but it is mandated
 /// by the BackingStore API. That is, this list is handed back to users.
+///
+/// Nothing else needs the full DAG: Atom loads resolve frames one at a
+/// time, as needed, with findFrame() and getFrame().
 HandleSeq RocksStorage::loadFrameDAG(void)
 {
 	CHECK_OPEN;
 
 	// If already loaded, just return the top frames.
-	if (_fid_map.size() > 0)
+	if (_frames_loaded)
 	{
-		HandleSeq tops(_top_frames.begin(), _top_frames.end());
+		FrameTablesPtr ft = frameTables();
+		HandleSeq tops(ft->top_frames.begin(), ft->top_frames.end());
 		return tops;
 	}
 
-	// Load all frames.
+	// Load all frames, into one new copy of the tables. Copying them
+	// for each frame would be quadratic in the number of frames.
+	std::lock_guard<std::mutex> flck(_mtx_frame);
+	auto nft = std::make_shared<FrameTables>(*frameTables());
 	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
 	for (it->Seek("d@"); it->Valid() and it->key().starts_with("d@"); it->Next())
 	{
 		const std::string& fid = it->key().ToString().substr(2);
-		getFrame(fid);
+		getFrame(fid, *nft);
 	}
 	delete it;
 
 	// Huh. There weren't any.
-	if (0 == _frame_map.size())
+	if (0 == nft->fid_map.size())
+	{
+		_frames_loaded = true;
 		return HandleSeq();
+	}
 
-	// Get all spaces that are subspaces
+	// Get all spaces that are subspaces. Use the fid map, and not the
+	// frame map, as there is exactly one AtomSpace per fid.
 	HandleSet all;
 	HandleSet subs;
-	for (const auto& pr : _frame_map)
+	for (const auto& pr : nft->fid_map)
 	{
-		const Handle& hasp = pr.first;
+		const Handle& hasp = pr.second;
 		all.insert(hasp);
 		for (const Handle& ho : hasp->getOutgoingSet())
 			subs.insert(ho);
@@ -266,9 +383,11 @@ HandleSeq RocksStorage::loadFrameDAG(void)
 	             return a->get_name() < b->get_name();
              });
 
-	_top_frames.clear();
-	_top_frames.reserve(roots.size());
-	_top_frames.insert(roots.begin(), roots.end());
+	nft->top_frames.clear();
+	nft->top_frames.reserve(roots.size());
+	nft->top_frames.insert(roots.begin(), roots.end());
+	publishFrames(std::move(nft));
+	_frames_loaded = true;
 	return roots;
 }
 
@@ -295,47 +414,67 @@ void RocksStorage::storeFrameDAG(AtomSpace* top)
 /// Most real-world use cases don't seem to do this. But we do test
 /// for it.
 ///
-/// `hasp` is an AtomSpacePtr.
-const RocksStorage::FramePath& RocksStorage::getPath(const Handle& hasp)
+/// `hasp` is an AtomSpacePtr. The paths are cached, and shared with
+/// the callers; they must not be changed.
+RocksStorage::FramePathPtr RocksStorage::getPath(const Handle& hasp)
 {
 	// Try to find it in the cache, first.
-	const auto& pr = _path_cache.find(hasp);
-	if (_path_cache.end() != pr)
-		return pr->second;
-
-	// Make the path, save it.
-	FramePath path;
-	makeOrder(hasp, path);
-	_path_cache.emplace(hasp, std::move(path));
-
-	// Grab what we just made.
-	const auto& prc = _path_cache.find(hasp);
-	return prc->second;
+	uint64_t gen = frameTables()->generation;
+	PathShard& shard = _path_cache[std::hash<Handle>()(hasp) % PATH_SHARDS];
+	{
+		std::lock_guard<std::mutex> lck(shard.mtx);
+		if (shard.generation == gen)
+		{
+			const auto& pr = shard.paths.find(hasp);
+			if (shard.paths.end() != pr)
+				return pr->second;
+		}
+	}
+
+	// Make the path, save it. But not if some frame was deleted
+	// in the meanwhile; the path might go through it.
+	auto order = std::make_shared<FramePath>();
+	makeOrder(hasp, *order);
+	FramePathPtr path(std::move(order));
+	if (frameTables()->generation != gen) return path;
+
+	std::lock_guard<std::mutex> lck(shard.mtx);
+	if (shard.generation < gen)
+	{
+		shard.paths.clear();
+		shard.generation = gen;
+	}
+	if (shard.generation == gen)
+		shard.paths.emplace(hasp, path);
+	return path;
 }
 
-void RocksStorage::makeOrder(Handle hasp, FramePath& order)
+/// The empty path, for DB's without frames.
+RocksStorage::FramePathPtr RocksStorage::noPath(void)
 {
-	// Get a map of what's held in storage.
-	if (_fid_map.size() == 0)
-		loadFrameDAG();
+	static const FramePathPtr empty = std::make_shared<const FramePath>();
+	return empty;
+}
 
+void RocksStorage::makeOrder(Handle hasp, FramePath& order)
+{
 	// As long as there's a stack of Frames, just loop.
 	while (true)
 	{
-		const auto& pr = _frame_map.find(hasp);
+		const std::string& fid = findFrame(hasp);
 
 		// This will happen when user is attempting to load Atoms
 		// into an AtomSpace that hasn't been stored to disk. The
 		// lookup is by name, so the user probably mmsityped the name.
 		// Anyway its a user error.
-		if (_frame_map.end() == pr)
+		if (0 == fid.size())
 			throw IOException(TRACE_INFO,
 				"The AtomSpace to be loaded is not stored on disk!\n"
 				"\tYou asked to load into %s\n"
 				"\tList all stored AtomSpaces with `(load-frames)`\n",
 				hasp->to_string("").c_str());
 
-		order.insert({strtoaid(pr->second), hasp});
+		order.insert({strtoaid(fid), hasp});
 		size_t nas = hasp->get_arity();
 		if (0 == nas) return;
 		if (1 < nas) break;
@@ -347,21 +486,202 @@ void RocksStorage::makeOrder(Handle hasp, FramePath& order)
 		makeOrder(ho, order);
 }
 
+// =========================================================
+// Frame membership filters.
+//
+// Most Atoms live in only one or two frames, while a frame stack
+// might be hundreds deep. Rather than going to disk to find out that
+// an Atom is not in any frame of a path, keep a Bloom filter of the
+// Atoms in each frame. These are built from the `o@fid:` index the
+// first time that a frame is asked about, and are then kept current
+// by addToFrame(). They can be trusted only if that index is complete;
+// that is, only for version 3 DB's.
+
+// Bits per member; with 6 probes, this is about a 1% false-positive
+// rate. Filters are built twice as large as needed, to leave room to
+// grow, and are rebuilt when they fill up.
+#define FILTER_BITS_PER_SID 10
+#define FILTER_PROBES 6
+
+// The aid's are sequential; scramble them. This is splitmix64.
+static inline uint64_t mix(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+void RocksStorage::SidFilter::add(uint64_t aid)
+{
+	uint64_t h = mix(aid);
+	uint64_t d = (h >> 32) | 1;
+	size_t nbits = bits.size() * 64;
+	for (int i = 0; i < FILTER_PROBES; i++)
+	{
+		size_t b = (h + i * d) & (nbits - 1);
+		bits[b / 64] |= 1ULL << (b % 64);
+	}
+	count++;
+}
+
+bool RocksStorage::SidFilter::has(uint64_t aid) const
+{
+	uint64_t h = mix(aid);
+	uint64_t d = (h >> 32) | 1;
+	size_t nbits = bits.size() * 64;
+	for (int i = 0; i < FILTER_PROBES; i++)
+	{
+		size_t b = (h + i * d) & (nbits - 1);
+		if (0 == (bits[b / 64] & (1ULL << (b % 64)))) return false;
+	}
+	return true;
+}
+
+/// Record that the Atom `sid` is in the frame `fidc`. The `fidc`
+/// must be the fid, followed by a colon.
+void RocksStorage::addToFrame(const std::string& fidc, const std::string& sid)
+{
+	// Most of the time, the Atom is already in the frame. If not,
+	// check again, under the lock, so that it is counted only once.
+	auto cfh = frameFamily(fidc);
+	std::string oid = memberPrefix(fidc) + sid;
+	std::string dummy;
+	if (_rfile->Get(rocksdb::ReadOptions(), cfh, oid, &dummy).ok())
+		return;
+
+	// Write first, and then update the filter. This way, a filter
+	// that is being built at the same time cannot miss this sid.
+	{
+		std::lock_guard<std::mutex> slck(sidLock(sid));
+		if (_rfile->Get(rocksdb::ReadOptions(), cfh, oid, &dummy).ok())
+			return;
+		rocksdb::WriteBatch batch;
+		batch.Put(cfh, oid, "");
+		addCount(batch, "c@" + fidc + "a", 1);
+		_rfile->Write(rocksdb::WriteOptions(), &batch);
+	}
+	addToFilter(fidc, sid);
+}
+
+/// Add the Atom `sid` to the filter of the frame `fidc`, if there is
+/// one. This must be done after the `o@` record has been written.
+void RocksStorage::addToFilter(const std::string& fidc, const std::string& sid)
+{
+	uint64_t faid = strtoaid(fidc.substr(0, fidc.size()-1));
+	uint64_t aid = strtoaid(sid);
+	std::lock_guard<std::mutex> lck(_mtx_filter);
+	auto bit = _filter_builds.find(faid);
+	if (_filter_builds.end() != bit) bit->second.added.push_back(aid);
+
+	auto it = _frame_filters.find(faid);
+	if (_frame_filters.end() == it) return;
+
+	SidFilter& filt = it->second;
+	filt.add(aid);
+
+	// If it's gotten too full, throw it away; it will be rebuilt.
+	if (filt.bits.size() * 64 < filt.count * FILTER_BITS_PER_SID)
+		_frame_filters.erase(it);
+}
+
+/// Build the filter for the frame `faid`, and return true if the Atom
+/// `aid` might be in it. The `o@` index is scanned without holding the
+/// filter lock, so that other frames can be used in the meantime. The
+/// Atoms that addToFrame() adds while the scan runs are recorded, and
+/// put into the filter at the end; the scan might miss them.
+bool RocksStorage::buildFilter(uint64_t faid, uint64_t aid)
+{
+	size_t epoch;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_filter);
+		_filter_builds[faid].builders ++;
+		epoch = _filter_epoch;
+	}
+
+	std::vector<std::string> members;
+	getFrameMembers(aidtostr(faid) + ":", members);
+
+	// Size it to a power of two, so that probes can be masked.
+	size_t nbits = 1024;
+	while (nbits < 2 * FILTER_BITS_PER_SID * members.size())
+		nbits *= 2;
+
+	SidFilter filt;
+	filt.bits.resize(nbits / 64, 0);
+	for (const std::string& msid : members)
+		filt.add(strtoaid(msid));
+
+	// If the filters were thrown away while this one was being built,
+	// then the frame might have changed under it; don't keep it.
+	std::lock_guard<std::mutex> lck(_mtx_filter);
+	if (epoch != _filter_epoch) return true;
+
+	auto bit = _filter_builds.find(faid);
+	for (uint64_t added : bit->second.added)
+		filt.add(added);
+	if (0 == -- bit->second.builders)
+		_filter_builds.erase(bit);
+
+	// If another thread got there first, keep that one.
+	bool has = filt.has(aid);
+	_frame_filters.emplace(faid, std::move(filt));
+	return has;
+}
+
+/// Throw away all of the filters, including any being built. They
+/// are rebuilt as needed.
+void RocksStorage::clearFilters(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx_filter);
+	_frame_filters.clear();
+	_filter_builds.clear();
+	_filter_epoch ++;
+}
+
+/// Return false if the Atom `sid` is definitely not in any of the
+/// frames in `frame_order`. Return true if it might be.
+bool RocksStorage::inPath(const FramePath& frame_order, const std::string& sid)
+{
+	if (not _frame_index) return true;
+
+	uint64_t aid = strtoaid(sid);
+
+	// Frames without a filter are looked at after the lock is let go.
+	std::vector<uint64_t> unfiltered;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_filter);
+		for (const auto& frit : frame_order)
+		{
+			auto it = _frame_filters.find(frit.first);
+			if (_frame_filters.end() == it)
+				unfiltered.push_back(frit.first);
+			else if (it->second.has(aid))
+				return true;
+		}
+	}
+
+	for (uint64_t faid : unfiltered)
+		if (buildFilter(faid, aid)) return true;
+	return false;
+}
+
 // =========================================================
 // Debug utility. Should return exactly the same thing as
-// what's in _top_frames.
+// what's in the top_frames table.
 
 HandleSeq RocksStorage::topFrames(void)
 {
 	HandleSeq tops;
-	for (const auto& pr : _frame_map)
+	FrameTablesPtr ft = frameTables();
+	for (const auto& pr : ft->fid_map)
 	{
-		const Handle& hasp = pr.first;
+		const Handle& hasp = pr.second;
 
 		bool found = false;
 		for (const Handle& hi : hasp->getIncomingSet())
 		{
-			if (_frame_map.end() != _frame_map.find(hi))
+			if (ft->frame_map.end() != ft->frame_map.find(hi))
 			{ found = true; break; }
 		}
 		if (not found) tops.push_back(hasp);
@@ -0,0 +1,208 @@
+/*
+ * RocksFamily.cc
+ * Column families for frames.
+ *
+ * Copyright (c) 2022 Linas Vepstas <linas@linas.org>
+ *
+ * LICENSE:
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "RocksStorage.h"
+#include "RocksUtils.h"
+
+using namespace opencog;
+
+// ======================================================================
+// Frame layouts
+// -------------
+// In the default layout, the per-frame records are kept with all of
+// the others, as `k@sid:fid:kid` and `o@fid:sid`. The records for one
+// frame are scattered all over the DB, and deleting a frame requires
+// deleting them one at a time.
+//
+// In the column-family layout, each frame gets a RocksDB column family
+// of its own, named `frame-fid`. The records in it are `k@sid:kid` and
+// `o@sid`; the fid is implied by the column family. Deleting a frame
+// is then a matter of dropping the column family. Each frame is also
+// compacted and cached separately. The cost is that fetching an Atom
+// requires one Seek per frame, instead of one Seek in all.
+//
+// The layout is chosen by adding `?column-families` to the URI, when
+// the DB is created (or, more precisely, before any frames are stored).
+// It is recorded in the DB, and cannot be changed later.
+//
+// The functions here hide the difference between the two layouts.
+// The `fidc` arguments are the fid, followed by a colon.
+
+/// Return the column family holding the records for frame `fidc`.
+/// If `create` is false, and there is no such family, return null.
+rocksdb::ColumnFamilyHandle*
+RocksStorage::frameFamily(const std::string& fidc, bool create)
+{
+	if (not _frame_families) return _rfile->DefaultColumnFamily();
+
+	std::string cfname = "frame-" + fidc.substr(0, fidc.size()-1);
+	std::lock_guard<std::mutex> lck(_mtx_family);
+	auto it = _families.find(cfname);
+	if (_families.end() != it) return it->second;
+	if (not create) return nullptr;
+
+	rocksdb::ColumnFamilyHandle* cfh;
+	rocksdb::Status s = _rfile->CreateColumnFamily(
+		_family_options, cfname, &cfh);
+	if (not s.ok())
+		throw IOException(TRACE_INFO, "Can't create column family %s: %s",
+			cfname.c_str(), s.ToString().c_str());
+	_families.emplace(cfname, cfh);
+	return cfh;
+}
+
+/// The prefix of the keys on Atom `sid` in frame `fidc`.
+std::string RocksStorage::keyPrefix(const std::string& sid,
+                                    const std::string& fidc)
+{
+	if (_frame_families) return "k@" + sid + ":";
+	return "k@" + sid + ":" + fidc;
+}
+
+/// The prefix of the membership records of frame `fidc`.
+std::string RocksStorage::memberPrefix(const std::string& fidc)
+{
+	if (_frame_families) return "o@";
+	return "o@" + fidc;
+}
+
+/// Get all of the key-value pairs for the Atom at `sid`, in each of
+/// the frames in `frame_order`, grouped by frame aid.
+void RocksStorage::getFrameKeys(const std::string& sid,
+                                const FramePath& frame_order,
+                                std::map<uint64_t, KeyVals>& frame_keys)
+{
+	std::string cid = "k@" + sid + ":";
+	size_t fidoff = cid.size();
+
+	// All of the frames holding keys for `sid` are contiguous, so
+	// this is done with a single scan, skipping any frames that are
+	// not in the path.
+	if (not _frame_families)
+	{
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+		for (it->Seek(cid); it->Valid() and it->key().starts_with(cid); it->Next())
+		{
+			const std::string& rks = it->key().ToString();
+			size_t colon = rks.find(':', fidoff);
+			if (std::string::npos == colon) continue;
+
+			uint64_t faid = strtoaid(rks.substr(fidoff, colon - fidoff));
+			if (frame_order.end() == frame_order.find(faid)) continue;
+
+			frame_keys[faid].push_back(
+				{rks.substr(colon + 1), it->value().ToString()});
+		}
+		delete it;
+		return;
+	}
+
+	// Otherwise, look in each frame.
+	for (const auto& frit : frame_order)
+	{
+		auto cfh = frameFamily(aidtostr(frit.first) + ":", false);
+		if (nullptr == cfh) continue;
+
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+		for (it->Seek(cid); it->Valid() and it->key().starts_with(cid); it->Next())
+			frame_keys[frit.first].push_back(
+				{it->key().ToString().substr(fidoff), it->value().ToString()});
+		delete it;
+	}
+}
+
+/// Append the sids of all of the Atoms in frame `fidc` to `sids`.
+void RocksStorage::getFrameMembers(const std::string& fidc,
+                                   std::vector<std::string>& sids)
+{
+	auto cfh = frameFamily(fidc, false);
+	if (nullptr == cfh) return;
+
+	std::string oid = memberPrefix(fidc);
+	size_t sidoff = oid.size();
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+	for (it->Seek(oid); it->Valid() and it->key().starts_with(oid); it->Next())
+		sids.push_back(it->key().ToString().substr(sidoff));
+	delete it;
+}
+
+/// Return true if the Atom `sid` has any keys in any frame.
+bool RocksStorage::hasFrameKeys(const std::string& sid)
+{
+	std::string cid = "k@" + sid + ":";
+	std::vector<rocksdb::ColumnFamilyHandle*> cfhs;
+	if (_frame_families)
+	{
+		std::lock_guard<std::mutex> lck(_mtx_family);
+		for (const auto& fpr : _families)
+			if (0 == fpr.first.compare(0, 6, "frame-"))
+				cfhs.push_back(fpr.second);
+	}
+	else
+		cfhs.push_back(_rfile->DefaultColumnFamily());
+
+	for (auto cfh : cfhs)
+	{
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+		it->Seek(cid);
+		bool found = it->Valid() and it->key().starts_with(cid);
+		delete it;
+		if (found) return true;
+	}
+	return false;
+}
+
+/// Drop the column family for frame `fidc`, and everything in it.
+void RocksStorage::dropFamily(const std::string& fidc)
+{
+	if (not _frame_families) return;
+
+	std::string cfname = "frame-" + fidc.substr(0, fidc.size()-1);
+	std::lock_guard<std::mutex> lck(_mtx_family);
+	auto it = _families.find(cfname);
+	if (_families.end() == it) return;
+
+	_rfile->DropColumnFamily(it->second);
+
+	// Other threads might still be holding the handle. It stays
+	// valid until it is destroyed; do that at close.
+	_dropped_families.push_back(it->second);
+	_families.erase(it);
+}
+
+/// Release all of the column family handles. Must be done before
+/// the DB is closed.
+void RocksStorage::closeFamilies(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx_family);
+	for (const auto& fpr : _families)
+		_rfile->DestroyColumnFamilyHandle(fpr.second);
+	for (auto cfh : _dropped_families)
+		_rfile->DestroyColumnFamilyHandle(cfh);
+	_families.clear();
+	_dropped_families.clear();
+}
+
+// ======================== THE END ======================
@@ -24,6 +24,9 @@
  */
 
 #include <iomanip> // for std::quote
+#include <set>
+
+#include "rocksdb/write_batch.h"
 
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/persist/sexpr/Sexpr.h>
@@ -42,6 +45,9 @@ using namespace opencog;
 /// These can be easily found, by searching for sids that have
 /// no k@ on them.  A DB scrub routine (not implemented) could
 /// "easily" remove them.
+///
+/// Only the frame records are deleted here; the keys on the Atoms
+/// are deleted by a background thread. See cleanFrame().
 void RocksStorage::deleteFrame(AtomSpace* frame)
 {
 	CHECK_OPEN;
@@ -49,63 +55,492 @@ void RocksStorage::deleteFrame(AtomSpace* frame)
 		throw IOException(TRACE_INFO, "There are no frames!");
 
 	std::string db_version = get_version();
-	if (0 != db_version.compare("2"))
+	if (0 != db_version.compare("2") and 0 != db_version.compare("3") and
+	    0 != db_version.compare("4"))
 		throw IOException(TRACE_INFO, "DB too old to support frame deletion!");
 
 	Handle hasp = HandleCast(frame);
 
+	// Frames are resolved lazily. Make sure that all of them are
+	// known, so that we can tell if this one is a top frame.
+	loadFrameDAG();
+	findFrame(hasp);
+
 	// Everything under here proceeds with the frame lock held.
 	std::lock_guard<std::mutex> flck(_mtx_frame);
+	FrameTablesPtr ft = frameTables();
 
 	// Silent return if we don't know if this AtomSpace.
 	// Presumably, it was deleted earlier, or never stored.
-	const auto& pr = _frame_map.find(hasp);
-	if (_frame_map.end() == pr)
+	const auto& pr = ft->frame_map.find(hasp);
+	if (ft->frame_map.end() == pr)
 		return;
 
 	// I'm too lazy to implement delete-from-the-middle. So throw
 	// if this is a non-top frame.
 	for (const Handle& hi : hasp->getIncomingSet())
-		if (_frame_map.end() != _frame_map.find(hi))
+		if (ft->frame_map.end() != ft->frame_map.find(hi))
 			throw IOException(TRACE_INFO,
 				"Deletion of non-top frames is not currently supported!\n");
 
-	// OK, we've got the frame to delete.
-	// First, get rid of all the atoms in it.
-	std::string fid = pr->second + ":";
-	std::string oid = "o@" + fid;
+	// The stored frames might sit on top of a different, but
+	// equivalent AtomSpace. Check those, too.
+	for (const auto& fpr : ft->fid_map)
+	{
+		for (const Handle& ho : fpr.second->getOutgoingSet())
+		{
+			const auto& opr = ft->frame_map.find(ho);
+			if (ft->frame_map.end() != opr and opr->second == pr->second)
+				throw IOException(TRACE_INFO,
+					"Deletion of non-top frames is not currently supported!\n");
+		}
+	}
+
+	// OK, we've got the frame to delete. Mark it as dead. Once the
+	// d@ and f@ records are gone, nothing can find it any more, and
+	// the Atoms in it are cleaned up in the background. If the frame
+	// has a column family of its own, just drop that.
+	std::string fid = pr->second;
+	if (not _frame_families)
+		_rfile->Put(rocksdb::WriteOptions(), "T@" + fid, "");
+
+	// A view of this frame is now meaningless.
+	dropView(fid);
+
+	// Delete the frame encoding.
+	std::string did = "d@" + fid;
+	std::string senc;
+	_rfile->Get(rocksdb::ReadOptions(), did, &senc);
+	_rfile->Delete(rocksdb::WriteOptions(), did);
+	_rfile->Delete(rocksdb::WriteOptions(), "f@" + senc);
+
+	// And the frame counters.
+	std::string ckey = "c@" + fid + ":";
+	addCount("C@f@", -1);
+	addCount("C@k@", -getCount(ckey + "v"));
+	_rfile->DeleteRange(rocksdb::WriteOptions(), ckey, prefix_end(ckey));
+
+	// Remove it from out own tables. There may be more than
+	// one AtomSpace resolved to this fid.
+	auto nft = std::make_shared<FrameTables>(*ft);
+	nft->fid_map.erase(fid);
+	for (auto fit = nft->frame_map.begin(); fit != nft->frame_map.end(); )
+	{
+		if (fit->second == fid)
+		{
+			nft->top_frames.erase(fit->first);
+			fit = nft->frame_map.erase(fit);
+		}
+		else fit++;
+	}
+	nft->generation++;
+	publishFrames(std::move(nft));
+
+	if (_frame_families)
+		dropFamily(fid + ":");
+	else
+		queueClean(fid);
+
+	std::lock_guard<std::mutex> lck(_mtx_filter);
+	_frame_filters.erase(strtoaid(fid));
+}
+
+// ======================================================================
+// Deleted frames are marked with a `T@fid` record. The keys on the
+// Atoms in the frame are deleted in a background thread; the mark is
+// removed when that is done. If the process dies before then, the
+// cleanup is restarted at the next open.
+
+void RocksStorage::queueClean(const std::string& fid)
+{
+	std::lock_guard<std::mutex> lck(_mtx_clean);
+	_clean_queue.push_back(fid);
+	if (_cleaning) return;
+
+	// The previous thread, if any, has already finished.
+	if (_cleaner.joinable()) _cleaner.join();
+	_cleaning = true;
+	_cleaner = std::thread(&RocksStorage::cleanFrames, this);
+}
+
+void RocksStorage::cleanFrames(void)
+{
+	while (true)
+	{
+		std::string fid;
+		{
+			std::lock_guard<std::mutex> lck(_mtx_clean);
+			if (_clean_queue.empty())
+			{
+				_cleaning = false;
+				return;
+			}
+			fid = _clean_queue.front();
+			_clean_queue.pop_front();
+		}
+		cleanFrame(fid);
+	}
+}
+
+/// Wait for the cleanup thread to finish all queued work.
+void RocksStorage::waitForCleaner(void)
+{
+	std::unique_lock<std::mutex> lck(_mtx_clean);
+	if (not _cleaner.joinable()) return;
+
+	// Take the thread, so that no one else tries to join it.
+	std::thread cleaner(std::move(_cleaner));
+	lck.unlock();
+	cleaner.join();
+}
+
+/// Delete the keys on all of the Atoms in the deleted frame `fid`.
+/// In the column-family layout, the family is simply dropped.
+void RocksStorage::cleanFrame(const std::string& fid)
+{
+	std::string fidc = fid + ":";
+	if (_frame_families)
+	{
+		dropFamily(fidc);
+		_rfile->Delete(rocksdb::WriteOptions(), "T@" + fid);
+		return;
+	}
 
-	// Loop over all atoms in the frame, and delete any keys on them.
+	std::string oid = "o@" + fidc;
 	size_t sidoff = oid.size();
+
+	rocksdb::WriteBatch batch;
 	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
 	for (it->Seek(oid); it->Valid() and it->key().starts_with(oid); it->Next())
 	{
-		const std::string& fis = it->key().ToString();
-		const std::string& sid = fis.substr(sidoff);
+		const std::string& sid = it->key().ToString().substr(sidoff);
 
 		// Delete all values hanging on the atom ...
-		std::string pfx = "k@" + sid + ":" + fid;
+		std::string pfx = "k@" + sid + ":" + fidc;
 		auto kt = _rfile->NewIterator(rocksdb::ReadOptions());
 		for (kt->Seek(pfx); kt->Valid() and kt->key().starts_with(pfx); kt->Next())
-			_rfile->Delete(rocksdb::WriteOptions(), kt->key());
+			batch.Delete(kt->key());
 		delete kt;
 
-		// Delete the key itself
-		_rfile->Delete(rocksdb::WriteOptions(), it->key());
+		if (CLEAN_BATCH_SIZE < batch.Count())
+		{
+			_rfile->Write(rocksdb::WriteOptions(), &batch);
+			batch.Clear();
+		}
 	}
 	delete it;
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
 
-	// Delete the frame encoding, too.
-	fid = pr->second;
-	std::string did = "d@" + fid;
-	std::string senc;
-	_rfile->Get(rocksdb::ReadOptions(), did, &senc);
-	_rfile->Delete(rocksdb::WriteOptions(), did);
-	_rfile->Delete(rocksdb::WriteOptions(), "f@" + senc);
+	// The membership and view records are contiguous.
+	_rfile->DeleteRange(rocksdb::WriteOptions(), oid, prefix_end(oid));
+	std::string vid = "v@" + fidc;
+	_rfile->DeleteRange(rocksdb::WriteOptions(), vid, prefix_end(vid));
 
-	// Finally, remove it from out own tables.
-	_fid_map.erase(fid);
-	_frame_map.erase(hasp);
+	_rfile->Delete(rocksdb::WriteOptions(), "T@" + fid);
+}
+
+// ======================================================================
+
+/// Merge the frame `top` with the `depth` frames underneath it, so that
+/// they become one frame. Only the Values visible from `top` are kept;
+/// everything that they shadow is deleted. The merged frame keeps the
+/// name and the fid of `top`, and sits on whatever the bottom of the
+/// merged run sat on. The frames in the run, other than `top`, must
+/// form a simple stack, and must not be used by any other frame.
+///
+/// The merged frame is written atomically. The records of the frames
+/// under the top are cleaned up in the background, as for deleteFrame().
+///
+/// The cached frames are discarded; the AtomSpaces that were in the
+/// run are no longer valid, and the frames must be loaded again.
+void RocksStorage::squashFrames(AtomSpace* top, size_t depth)
+{
+	CHECK_OPEN;
+	if (not _multi_space)
+		throw IOException(TRACE_INFO, "There are no frames!");
+	if (not _frame_index)
+		throw IOException(TRACE_INFO, "DB too old to support squashing frames!");
+
+	// All of the frames are needed, to check for other users of
+	// the frames in the run.
+	loadFrameDAG();
+
+	Handle hasp = HandleCast(top);
+	std::string tfid = findFrame(hasp);
+	if (0 == tfid.size())
+		throw IOException(TRACE_INFO,
+			"The AtomSpace %s is not stored on disk!\n",
+			top->get_name().c_str());
+
+	// Walk down the stack, collecting the run.
+	HandleSeq run({hasp});
+	Handle hrun = hasp;
+	for (size_t i = 0; i < depth and 0 < hrun->get_arity(); i++)
+	{
+		if (1 < hrun->get_arity())
+			throw IOException(TRACE_INFO,
+				"Can only squash a simple stack of frames!\n");
+		hrun = hrun->getOutgoingAtom(0);
+		run.push_back(hrun);
+	}
+	if (1 == run.size()) return;
+
+	std::vector<std::string> run_fids;
+	FramePath run_path;
+	for (const Handle& hr : run)
+	{
+		const std::string& fid = findFrame(hr);
+		run_fids.push_back(fid);
+		run_path.emplace(strtoaid(fid), hr);
+	}
+
+	// Everything below the run. The merged frame will sit on this.
+	FramePath below;
+	std::string senc = "(AtomSpace ";
+	std::stringstream ss;
+	ss << std::quoted(top->get_name());
+	senc += ss.str();
+	for (const Handle& ho : hrun->getOutgoingSet())
+	{
+		senc += " " + findFrame(ho);
+		FramePathPtr bpath = getPath(ho);
+		below.insert(bpath->begin(), bpath->end());
+	}
+	senc += ")";
+
+	std::string osid;
+	_rfile->Get(rocksdb::ReadOptions(), "f@" + senc, &osid);
+	if (0 < osid.size())
+		throw IOException(TRACE_INFO,
+			"There already is a frame %s; can't squash into it!\n",
+			senc.c_str());
+
+	// Everything under here proceeds with the frame lock held.
+	std::lock_guard<std::mutex> flck(_mtx_frame);
+
+	// The frames in the run must not be used by anything else.
+	for (const auto& fpr : frameTables()->fid_map)
+	{
+		for (size_t i = 1; i < run.size(); i++)
+		{
+			if (run[i-1] == fpr.second) continue;
+			for (const Handle& ho : fpr.second->getOutgoingSet())
+				if (ho == run[i])
+					throw IOException(TRACE_INFO,
+						"Can't squash frame %s; it is used by %s!\n",
+						run[i]->get_name().c_str(),
+						fpr.second->get_name().c_str());
+		}
+	}
+
+	// Every Atom in every frame in the run.
+	std::vector<std::string> members;
+	for (const std::string& fid : run_fids)
+		getFrameMembers(fid + ":", members);
+	std::set<std::string> sids(members.begin(), members.end());
+
+	// The merged frame is written in one batch, so that a crash
+	// leaves either the old frames, or the merged one, and nothing
+	// in between. The frames under the top are marked with `T@`, as
+	// in deleteFrame(); their records are cleaned up afterwards, in
+	// the background, and the cleanup resumes at open if need be.
+	rocksdb::WriteBatch batch;
+	std::string tfidc = tfid + ":";
+	uint64_t taid = strtoaid(tfid);
+	auto tcfh = frameFamily(tfidc);
+
+	// Out with the old membership records of the top.
+	std::string toid = memberPrefix(tfidc);
+	batch.DeleteRange(tcfh, toid, prefix_end(toid));
+
+	// Rewrite the records for each Atom into the top. Keep the records
+	// of the highest frame in the run having any.
+	FramePath both(below);
+	both.insert(run_path.begin(), run_path.end());
+	size_t natoms = 0;
+	size_t nvals = 0;
+	for (const std::string& sid : sids)
+	{
+		std::map<uint64_t, KeyVals> frame_keys;
+		getFrameKeys(sid, both, frame_keys);
+
+		bool shadows = false;
+		for (auto fk = frame_keys.begin(); fk != frame_keys.end(); )
+		{
+			if (run_path.end() == run_path.find(fk->first))
+			{
+				shadows = true;
+				fk = frame_keys.erase(fk);
+				continue;
+			}
+			fk++;
+		}
+
+		// The top's own records go; what is kept is put back, below.
+		std::string skid = keyPrefix(sid, tfidc);
+		const auto& tkv = frame_keys.find(taid);
+		if (frame_keys.end() != tkv)
+			for (const auto& kv : tkv->second)
+				batch.Delete(tcfh, skid + kv.first);
+
+		// A deletion mark with nothing under it to hide is not needed.
+		// Likewise, a hide mark on a `+`.
+		KeyVals kvs = resolveKeys(frame_keys);
+		if (0 == kvs.size()) continue;
+		if ('-' == kvs[0].first[0] and not shadows) continue;
+		if ('+' == kvs[0].first[0] and not shadows) kvs[0].second.clear();
+
+		for (const auto& kv : kvs)
+		{
+			batch.Put(tcfh, skid + kv.first, kv.second);
+			if ('+' != kv.first[0] and '-' != kv.first[0]) nvals++;
+		}
+		batch.Put(tcfh, memberPrefix(tfidc) + sid, "");
+		natoms++;
+	}
+
+	// Recount.
+	int64_t oldvals = 0;
+	for (const std::string& fid : run_fids)
+		oldvals += getCount("c@" + fid + ":v");
+	batch.Merge("C@k@", std::to_string(nvals - oldvals));
+	batch.Merge("C@f@", std::to_string(1 - (int64_t) run_fids.size()));
+	batch.Put("c@" + tfidc + "a", std::to_string(natoms));
+	batch.Put("c@" + tfidc + "v", std::to_string(nvals));
+
+	// Delete the frames in the run, and re-encode the top.
+	for (const std::string& fid : run_fids)
+	{
+		std::string did = "d@" + fid;
+		std::string oenc;
+		_rfile->Get(rocksdb::ReadOptions(), did, &oenc);
+		batch.Delete(did);
+		batch.Delete("f@" + oenc);
+		if (fid == tfid) continue;
+
+		std::string ckey = "c@" + fid + ":";
+		batch.DeleteRange(ckey, prefix_end(ckey));
+		batch.Put("T@" + fid, "");
+	}
+	batch.Put("f@" + senc, tfid);
+	batch.Put("d@" + tfid, senc);
+
+	// Views of the frames in the run go away. The view of the top
+	// is unchanged. The view records of the remaining views that
+	// were copied from frames in the run are now in the top of it.
+	// Their paths will be recomputed.
+	std::set<std::string> gone(run_fids.begin() + 1, run_fids.end());
+	std::lock_guard<std::shared_mutex> vlck(_mtx_view);
+	for (const std::string& fid : gone)
+	{
+		if (0 == _views.erase(strtoaid(fid))) continue;
+		batch.Delete("V@" + fid);
+		std::string vid = "v@" + fid + ":";
+		batch.DeleteRange(vid, prefix_end(vid));
+	}
+	for (auto& vpr : _views)
+	{
+		vpr.second.clear();
+		for (const std::string& sid : sids)
+		{
+			std::string cid = "v@" + aidtostr(vpr.first) + ":" + sid + ":";
+			KeyVals kvs;
+			bool moved = false;
+			auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+			for (it->Seek(cid); it->Valid() and it->key().starts_with(cid); it->Next())
+			{
+				const std::string& rks = it->key().ToString();
+				size_t colon = rks.find(':', cid.size());
+				if (gone.count(rks.substr(cid.size(), colon - cid.size())))
+					moved = true;
+				kvs.push_back({rks.substr(colon + 1), it->value().ToString()});
+			}
+			delete it;
+			if (moved) writeView(batch, cid, taid, kvs);
+		}
+	}
+
+	rocksdb::Status s = _rfile->Write(rocksdb::WriteOptions(), &batch);
+	if (not s.ok())
+		throw IOException(TRACE_INFO, "Can't squash frames: %s",
+			s.ToString().c_str());
+
+	// Start over, with the frame caches. The AtomSpaces merged into
+	// the top are remembered, so that they can't be used to write
+	// into a frame that is no longer there, or to read from one. The
+	// old top sits on them, so it can't be used either.
+	auto nft = std::make_shared<FrameTables>();
+	nft->generation = frameTables()->generation + 1;
+	nft->squashed = frameTables()->squashed;
+	nft->squashed.insert(run.begin() + 1, run.end());
+	publishFrames(std::move(nft));
+	_frames_loaded = false;
+
+	clearFilters();
+
+	// Now get rid of the records of the frames under the top.
+	for (const std::string& fid : gone)
+		queueClean(fid);
+}
+
+// ======================================================================
+
+/// Compare the contents of frame `a` to that of frame `b`, as they
+/// would be seen after loading each. Atoms visible in `b` but not in
+/// `a` are appended to `added`; those visible in `a` but not in `b`
+/// are appended to `removed`; those visible in both, but having
+/// different Values, are appended to `changed`. The Atoms are not
+/// placed in any AtomSpace.
+///
+/// Nothing is loaded. Only the Atoms in frames that are on one path
+/// but not the other are looked at; everything else looks the same
+/// from both frames.
+void RocksStorage::diffFrames(AtomSpace* a, AtomSpace* b,
+                              HandleSeq& added, HandleSeq& removed,
+                              HandleSeq& changed)
+{
+	CHECK_OPEN;
+	if (not _multi_space)
+		throw IOException(TRACE_INFO, "There are no frames!");
+	if (not _frame_index)
+		throw IOException(TRACE_INFO, "DB too old to support frame diffs!");
+
+	FramePathPtr papath = getPath(HandleCast(a));
+	FramePathPtr pbpath = getPath(HandleCast(b));
+	const FramePath& apath = *papath;
+	const FramePath& bpath = *pbpath;
+
+	// The frames on only one of the two paths.
+	std::vector<std::string> members;
+	for (const auto& frit : apath)
+		if (bpath.end() == bpath.find(frit.first))
+			getFrameMembers(aidtostr(frit.first) + ":", members);
+	for (const auto& frit : bpath)
+		if (apath.end() == apath.find(frit.first))
+			getFrameMembers(aidtostr(frit.first) + ":", members);
+	std::set<std::string> sids(members.begin(), members.end());
+
+	for (const std::string& sid : sids)
+	{
+		std::map<uint64_t, KeyVals> akeys;
+		std::map<uint64_t, KeyVals> bkeys;
+		getFrameKeys(sid, apath, akeys);
+		getFrameKeys(sid, bpath, bkeys);
+		const KeyVals& akvs = resolveKeys(akeys);
+		const KeyVals& bkvs = resolveKeys(bkeys);
+
+		bool in_a = 0 < akvs.size() and '-' != akvs[0].first[0];
+		bool in_b = 0 < bkvs.size() and '-' != bkvs[0].first[0];
+		if (not in_a and not in_b) continue;
+		if (in_a and in_b and akvs == bkvs) continue;
+
+		Handle h = getAtom(sid);
+		if (nullptr == h) continue;
+
+		if (not in_a) added.push_back(h);
+		else if (not in_b) removed.push_back(h);
+		else changed.push_back(h);
+	}
 }
 
 // ======================================================================
@@ -117,6 +552,18 @@ void RocksStorage::deleteFrame(AtomSpace* frame)
 void RocksStorage::convertForFrames(const Handle& top)
 {
 	if (_multi_space) return;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_marginal);
+		if (not _marginals.empty())
+			throw IOException(TRACE_INFO,
+				"Frames cannot be stored in a file with marginals!");
+	}
+	{
+		std::lock_guard<std::mutex> lck(_mtx_order);
+		if (not _orders.empty())
+			throw IOException(TRACE_INFO,
+				"Frames cannot be stored in a file with ordered indexes!");
+	}
 	_multi_space = true;
 
 	writeFrame(top);
@@ -146,8 +593,11 @@ void RocksStorage::convertForFrames(const Handle& top)
 
 	// Get the frame ID to which everything will be consigned to.
 	std::string fid = writeFrame(bot) + ":";
+	auto cfh = frameFamily(fid);
 
 	// Loop over all atoms, and convert keys.
+	size_t natoms = 0;
+	size_t nvals = 0;
 	it = _rfile->NewIterator(rocksdb::ReadOptions());
 	for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
 	{
@@ -162,10 +612,11 @@ void RocksStorage::convertForFrames(const Handle& top)
 		{
 			std::string kid = kit->key().ToString();
 			std::string skid = kid;
-			skid.insert(skid.find(':') + 1, fid);
+			if (not _frame_families)
+				skid.insert(skid.find(':') + 1, fid);
 
 			const std::string& kval = kit->value().ToString();
-			_rfile->Put(rocksdb::WriteOptions(), skid, kval);
+			_rfile->Put(rocksdb::WriteOptions(), cfh, skid, kval);
 
 			_rfile->Delete(rocksdb::WriteOptions(), kid);
 			nkeys ++;
@@ -174,18 +625,24 @@ void RocksStorage::convertForFrames(const Handle& top)
 
 		// If there were no keys, write the marker.
 		if (0 == nkeys)
-			_rfile->Put(rocksdb::WriteOptions(), akey + fid + "+1", "");
+			_rfile->Put(rocksdb::WriteOptions(), cfh,
+				keyPrefix(sid, fid) + "+1", "");
 
 		// Write the frame membership.
-		_rfile->Put(rocksdb::WriteOptions(), "o@" + fid + sid, "");
+		_rfile->Put(rocksdb::WriteOptions(), cfh, memberPrefix(fid) + sid, "");
+		natoms ++;
+		nvals += nkeys;
 
 		// Compute the height, and store that.
 		try {
 			Handle h = Sexpr::decode_atom(it->value().ToString());
 			size_t height = getHeight(h);
 			if (0 < height)
-				_rfile->Put(rocksdb::WriteOptions(),
-					"z" + aidtostr(height) + "@" + sid, "");
+			{
+				std::string zed = "z" + aidtostr(height) + "@";
+				_rfile->Put(rocksdb::WriteOptions(), zed + sid, "");
+				addCount("C@" + zed, 1);
+			}
 		} catch (const SyntaxException& ex) {
 			// This will happen if a Type is unknown. Either the user forgot
 			// to load the module that defines that type, or this is an old
@@ -195,6 +652,43 @@ void RocksStorage::convertForFrames(const Handle& top)
 		}
 	}
 	delete it;
+
+	_rfile->Put(rocksdb::WriteOptions(), "c@" + fid + "a", std::to_string(natoms));
+	_rfile->Put(rocksdb::WriteOptions(), "c@" + fid + "v", std::to_string(nvals));
+}
+
+// ======================================================================
+
+/// Rebuild the frame membership index. Older DB's recorded only the
+/// frame in which an Atom first appeared; this adds an `o@fid:sid`
+/// record for every frame that has a `k@sid:fid:` record. All of the
+/// records for one Atom and frame are adjacent, so only the first of
+/// each run needs to be looked at.
+void RocksStorage::indexFrames(void)
+{
+	printf("Rocks: upgrading frame index; please wait ...\n");
+	size_t cnt = 0;
+	std::string last;
+	std::string pfx = "k@";
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
+	{
+		if (0 < last.size() and it->key().starts_with(last)) continue;
+
+		// The key is of the form `k@sid:fid:kid`
+		const std::string& rks = it->key().ToString();
+		size_t sc = rks.find(':');
+		size_t fc = rks.find(':', sc+1);
+		if (std::string::npos == fc) continue;
+		last = rks.substr(0, fc+1);
+
+		const std::string& sid = rks.substr(2, sc-2);
+		const std::string& fid = rks.substr(sc+1, fc-sc);
+		_rfile->Put(rocksdb::WriteOptions(), "o@" + fid + sid, "");
+		cnt++;
+	}
+	delete it;
+	printf("Rocks: indexed %zu Atom-frame pairs.\n", cnt);
 }
 
 // ======================================================================
@@ -203,6 +697,9 @@ void RocksStorage::convertForFrames(const Handle& top)
 bool RocksStorage::checkFrames(void)
 {
 	CHECK_OPEN;
+
+	// Deleted frames must be completely gone, first.
+	waitForCleaner();
 	if (not _multi_space) return true;
 
 	// Look for atoms that have no keys on them.
@@ -212,17 +709,14 @@ bool RocksStorage::checkFrames(void)
 	for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
 	{
 		std::string akey = it->key().ToString();
-		akey[0] = 'k';
-		auto kt = _rfile->NewIterator(rocksdb::ReadOptions());
-		kt->Seek(akey);
-		if (not (kt->Valid() and kt->key().starts_with(akey)))
+		const std::string& sid = akey.substr(2, akey.size()-3);
+		if (not hasFrameKeys(sid))
 		{
 			// `a@1:` is the key for (PredicateNode "*-TruthValueKey-*")
 			// and ignore that as a special case.
-			if (akey.compare("k@1:"))
+			if (sid.compare("1"))
 				cnt++;
 		}
-		delete kt;
 	}
 	delete it;
 
@@ -241,6 +735,9 @@ bool RocksStorage::checkFrames(void)
 void RocksStorage::scrubFrames(void)
 {
 	CHECK_OPEN;
+
+	// Deleted frames must be completely gone, first.
+	waitForCleaner();
 	if (not _multi_space) return;
 
 	size_t cnt = 0;
@@ -250,36 +747,40 @@ void RocksStorage::scrubFrames(void)
 	for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
 	{
 		std::string akey = it->key().ToString();
-		akey[0] = 'k';
-		auto kt = _rfile->NewIterator(rocksdb::ReadOptions());
-		kt->Seek(akey);
-		if (kt->Valid() and kt->key().starts_with(akey))
-		  { delete kt; continue; }
-
-		delete kt;
+		if (hasFrameKeys(akey.substr(2, akey.size()-3))) continue;
 
 		// `a@1:` is the key for (PredicateNode "*-TruthValueKey-*")
 		// Ignore it as a special case.
-		if (0 == akey.compare("k@1:")) continue;
+		if (0 == akey.compare("a@1:")) continue;
 
 		// We've found an orphan. Delete the `a@` index entry.
 		std::string satom = it->value().ToString();
+		const std::string& sid = akey.substr(2, akey.size()-3);
 		akey[0] = 'a';
 		_rfile->Delete(rocksdb::WriteOptions(), akey);
 
 		// Delete the incoming sets, too.
 		// To get fancy, could use DeleteRange() here.
 		akey[0] = 'i';
+		int64_t nin = 0;
 		auto ic = _rfile->NewIterator(rocksdb::ReadOptions());
 		for (ic->Seek(akey); ic->Valid() and ic->key().starts_with(akey); ic->Next())
 		{
 			std::string inky = ic->key().ToString();
 			_rfile->Delete(rocksdb::WriteOptions(), inky);
+			nin++;
 		}
+		delete ic;
+		addCount("C@i@", -nin);
+		akey[0] = 'I';
+		_rfile->DeleteRange(rocksdb::WriteOptions(), akey, prefix_end(akey));
+		akey[0] = 's';
+		_rfile->Delete(rocksdb::WriteOptions(), akey);
 
 		// We won't know if it is a Node or Link till we decode it.
 		try {
 			Handle orph =  Sexpr::decode_atom(satom);
+			countAtom(satom, orph->is_node(), -1);
 			if (orph->is_node())
 				_rfile->Delete(rocksdb::WriteOptions(), "n@" + satom);
 			else
@@ -288,9 +789,9 @@ void RocksStorage::scrubFrames(void)
 
 				// Also delete the zN@sid entries.
 				size_t height = getHeight(orph);
-				const std::string& sid = akey.substr(2);
-				_rfile->Delete(rocksdb::WriteOptions(),
-					"z" + aidtostr(height) + "@" + sid);
+				std::string zed = "z" + aidtostr(height) + "@";
+				_rfile->Delete(rocksdb::WriteOptions(), zed + sid);
+				addCount("C@" + zed, -1);
 			}
 		} catch (const SyntaxException& ex) {
 			// This will happen if a Type is unknown. Either the user forgot
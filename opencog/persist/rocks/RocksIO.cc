@@ -23,9 +23,18 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <iomanip> // for std::quoted
+#include <random>
+#include <sstream>
+#include <unordered_set>
+
+#include "rocksdb/convenience.h"
+#include "rocksdb/write_batch.h"
+
 #include <opencog/atoms/base/Atom.h>
 #include <opencog/atoms/base/Node.h>
 #include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/value/FloatValue.h>
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/persist/sexpr/Sexpr.h>
 
@@ -96,6 +105,8 @@ uint64_t RocksStorage::strtoaid(const std::string& sid) const
 // "k@" sid:kid . sval -- find the Atomese Value for the Atom,Key
 // "i@" sid:stype-sid . (null) -- finds IncomingSet of sid
 // "h@" shash . sid-list -- finds all sids having a given hash
+// "s@" sid: . sid-list -- the distinct sids in the outgoing set of
+//                         the Link sid, in order
 //
 // Multi-AtomSpaces also use the following keys:
 // "d@" fid . senc -- finds the AtomSpace frame (delta) for fid
@@ -103,8 +114,37 @@ uint64_t RocksStorage::strtoaid(const std::string& sid) const
 // "k@" sid:fid:kid . sval -- find the Value for the Atom,AtomSpace,Key
 //                            Absent Atoms have a kid = -
 //                            Keyless Atoms have a kid = +
-// "o@" fid:sid . (null) -- find Atoms in a given frame
+//                            and, if they hide an Atom deleted
+//                            in a frame below, an sval = -
+// "o@" fid:sid . (null) -- find Atoms in a given frame; there is one
+//                          for every frame having a k@sid:fid: record.
 // "z" N@sid . (null) -- record height N of Link at sid
+// "V@" fid . (null) -- frame fid has a materialized view
+// "v@" fid:sid:vfid:kid . sval -- the Value for the Atom,Key as seen
+//                            from frame fid; vfid is the frame that
+//                            holds it. Same kid markers as k@.
+// "T@" fid . (null) -- frame fid was deleted, or squashed into another;
+//                       clean up its records.
+// "c@" fid:a . count -- number of Atoms in frame fid
+// "c@" fid:v . count -- number of Values in frame fid
+// "I@" sid: . count -- size of the incoming set of sid
+// "I@" sid:stype . count -- size of the incoming set of sid, by type
+// "m@" stype:kid . (null) -- sums of the Values at key kid, over
+//                             Links of type stype, are kept
+// "M@" sid:stype:kid:pos . sval -- the sum, over the Links of type
+//                             stype holding sid at position pos
+// "K@" kid:sid . (null) -- the Atom sid has a Value at key kid, in
+//                          some frame. See RocksKeyIndex.cc
+// "x@" kid:idx . (null) -- Atoms are sorted by number idx at key kid
+// "X@" kid:idx:num:sid . (null) -- the Atom sid has the number num at
+//                          idx in its Value at kid. See RocksOrder.cc
+// "C@" pfx . count -- number of records having prefix pfx, for the
+//                     prefixes a@ n@ l@ f@ i@ h@ k@ and zN@
+// "C@" t:type . count -- number of Atoms of the given type
+//
+// With the `?column-families` URI option, the per-frame "k@" and "o@"
+// records are kept in a column family per frame, as "k@" sid:kid and
+// "o@" sid. See RocksFamily.cc
 //
 // General design:
 // ---------------
@@ -294,8 +334,10 @@ std::string RocksStorage::writeAtom(const Handle& h, bool need_mark)
 			if (_multi_space and as)
 			{
 				const std::string& fid = writeFrame(as) + ":";
-				std::string delmark = "k@" + sid + ":" + fid + "-1";
-				_rfile->Delete(rocksdb::WriteOptions(), delmark);
+				std::string delmark = keyPrefix(sid, fid) + "-1";
+				_rfile->Delete(rocksdb::WriteOptions(),
+					frameFamily(fid), delmark);
+				if (need_mark) updateViews(fid, sid);
 			}
 			return sid;
 		}
@@ -310,6 +352,7 @@ std::string RocksStorage::writeAtom(const Handle& h, bool need_mark)
 	// logger().debug("Store sid=>>%s<< for >>%s<<", sid.c_str(), satom.c_str());
 	_rfile->Put(rocksdb::WriteOptions(), pfx + satom, sid);
 	_rfile->Put(rocksdb::WriteOptions(), "a@" + sid + ":", shash+satom);
+	countAtom(satom, h->is_node(), 1);
 
 	if (convertible)
 		appendToSidList(shash, sid);
@@ -318,13 +361,13 @@ std::string RocksStorage::writeAtom(const Handle& h, bool need_mark)
 	{
 		AtomSpace* as = h->getAtomSpace();
 		const std::string& fid = writeFrame(as) + ":";
-		std::string oid = "o@" + fid + sid;
-		_rfile->Put(rocksdb::WriteOptions(), oid, "");
+		addToFrame(fid, sid);
 
 		// If this atom has a delete-mark on it, then undelete it.
-		std::string kid = "k@" + sid + ":" + fid;
+		auto cfh = frameFamily(fid);
+		std::string kid = keyPrefix(sid, fid);
 		std::string delmark = kid + "-1";
-		_rfile->Delete(rocksdb::WriteOptions(), delmark);
+		_rfile->Delete(rocksdb::WriteOptions(), cfh, delmark);
 
 		// Need to record which frame this Atom first appears in.
 		// This is done using k@ records. There needs to be at least
@@ -333,11 +376,12 @@ std::string RocksStorage::writeAtom(const Handle& h, bool need_mark)
 		// that keys will be written shortly.
 		if (need_mark or not h->haveValues())
 		{
-			auto kt = _rfile->NewIterator(rocksdb::ReadOptions());
+			auto kt = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
 			kt->Seek(kid);
 			if (not (kt->Valid() and kt->key().starts_with(kid)))
-				_rfile->Put(rocksdb::WriteOptions(), kid + "+1", "");
+				_rfile->Put(rocksdb::WriteOptions(), cfh, kid + "+1", "");
 			delete kt;
+			if (need_mark) updateViews(fid, sid);
 		}
 	}
 
@@ -350,19 +394,33 @@ std::string RocksStorage::writeAtom(const Handle& h, bool need_mark)
 
 	// Store the outgoing set ... just in case someone asks for it.
 	// The key is in the format `i@sid:type` and the type is used
-	// for get-incoming-by-type searches.
+	// for get-incoming-by-type searches. The same Atom might appear
+	// more than once in the outgoing set; count it only once.
+	//
+	// The distinct sids are kept in the `s@` record, as well, so that
+	// the incoming sets can be fixed up when the Link is deleted,
+	// without looking anything up.
+	std::set<std::string> ists;
+	std::string sidlist;
 	for (const Handle& ho : h->getOutgoingSet())
 	{
-		std::string ist = "i@" + writeAtom(ho) + stype;
-		appendToInset(ist, sid);
+		const std::string& osid = writeAtom(ho);
+		std::string ist = "i@" + osid + stype;
+		if (ists.insert(ist).second)
+		{
+			appendToInset(ist, sid);
+			sidlist += osid + " ";
+		}
 	}
+	_rfile->Put(rocksdb::WriteOptions(), "s@" + sid + ":", sidlist);
 
 	// Record the height of the link. Needed for ordered restore.
 	if (_multi_space)
 	{
 		size_t height = getHeight(h);
-		_rfile->Put(rocksdb::WriteOptions(),
-			"z" + aidtostr(height) + "@" + sid, "");
+		std::string zed = "z" + aidtostr(height) + "@";
+		_rfile->Put(rocksdb::WriteOptions(), zed + sid, "");
+		addCount("C@" + zed, 1);
 	}
 
 	return sid;
@@ -375,66 +433,180 @@ void RocksStorage::storeAtom(const Handle& h, bool synchronous)
 
 	// Separator for keys
 	std::string cid = "k@" + sid + ":";
+	std::string fid;
+	auto cfh = _rfile->DefaultColumnFamily();
 	if (_multi_space)
 	{
-		const std::string& fid = writeFrame(h->getAtomSpace()) + ":";
-		cid += fid;
+		fid = writeFrame(h->getAtomSpace()) + ":";
+		cid = keyPrefix(sid, fid);
+		cfh = frameFamily(fid);
+
+		// Record frame membership.
+		addToFrame(fid, sid);
 
 		// If there are no keys(!!) record a bogus key to mark the frame.
 		// If there are keys, then clobber any pre-existing marker!
 		std::string marker = cid + "+1";
 		if (not h->haveValues())
-			_rfile->Put(rocksdb::WriteOptions(), marker, "");
+			_rfile->Put(rocksdb::WriteOptions(), cfh, marker, "");
 		else
-			_rfile->Delete(rocksdb::WriteOptions(), marker);
+			_rfile->Delete(rocksdb::WriteOptions(), cfh, marker);
 	}
 
 	// Store all the keys on the atom ...
+	std::shared_lock<std::shared_mutex> dlck(_mtx_declare, std::defer_lock);
+	if (not _multi_space) dlck.lock();
 	for (const Handle& key : h->getKeys())
-		storeValue(cid + writeAtom(key), h->getValue(key));
+	{
+		const std::string& kid = writeAtom(key);
+		const std::string& mid = marginalId(h, kid);
+		if (0 < mid.size())
+			storeMarginal(mid, h, cid + kid, h->getValue(key));
+		else
+			storeValue(cfh, fid, cid + kid, h->getValue(key));
+	}
+
+	if (_multi_space)
+		updateViews(fid, sid);
 }
 
 void RocksStorage::storeMissingAtom(AtomSpace* as, const Handle& h)
 {
 	std::string sid = writeAtom(h, false);
+	std::string fid = writeFrame(as) + ":";
+
+	// Record frame membership.
+	addToFrame(fid, sid);
 
 	// Separator for keys
-	std::string skid = "k@" + sid + ":" + writeFrame(as) + ":";
+	auto cfh = frameFamily(fid);
+	std::string skid = keyPrefix(sid, fid);
 
 	// If there is a previous marker, erase it!
 	std::string marker = skid + "+1";
-	_rfile->Delete(rocksdb::WriteOptions(), marker);
+	_rfile->Delete(rocksdb::WriteOptions(), cfh, marker);
 
 	// Store an intentionally invalid key.
-	_rfile->Put(rocksdb::WriteOptions(), skid + "-1", "");
+	_rfile->Put(rocksdb::WriteOptions(), cfh, skid + "-1", "");
+
+	updateViews(fid, sid);
 }
 
-void RocksStorage::storeValue(const std::string& skid,
+/// Store the Value `vp` at `skid`. New Values are counted; if `fidc`
+/// is not empty, they are counted in that frame, too.
+void RocksStorage::storeValue(rocksdb::ColumnFamilyHandle* cfh,
+                              const std::string& fidc,
+                              const std::string& skid,
                               const ValuePtr& vp)
 {
 	std::string sval = Sexpr::encode_value(vp);
-	_rfile->Put(rocksdb::WriteOptions(), skid, sval);
+
+	// Keys with an ordered index need the old Value. See RocksOrder.cc
+	if (0 == fidc.size())
+	{
+		const std::set<size_t>& idxs =
+			orderIndexes(skid.substr(skid.rfind(':') + 1));
+		if (0 < idxs.size())
+		{
+			storeOrdered(skid, sval, idxs);
+			return;
+		}
+	}
+
+	// Most Values are overwrites. If not, check again, under the
+	// lock for the Atom, so that it is counted only once.
+	std::string dummy;
+	if (_rfile->Get(rocksdb::ReadOptions(), cfh, skid, &dummy).ok())
+	{
+		_rfile->Put(rocksdb::WriteOptions(), cfh, skid, sval);
+		return;
+	}
+
+	std::lock_guard<std::mutex> slck(sidLock(skid.substr(2, skid.find(':') - 2)));
+	if (_rfile->Get(rocksdb::ReadOptions(), cfh, skid, &dummy).ok())
+	{
+		_rfile->Put(rocksdb::WriteOptions(), cfh, skid, sval);
+		return;
+	}
+
+	// The Value, its counts and its index record go in together.
+	rocksdb::WriteBatch batch;
+	batch.Put(cfh, skid, sval);
+	addCount(batch, "C@k@", 1);
+	if (0 < fidc.size()) addCount(batch, "c@" + fidc + "v", 1);
+	if (_key_index) indexKey(batch, skid);
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
 }
 
 /// Backing-store API.
 void RocksStorage::storeValue(const Handle& h, const Handle& key)
+{
+	writeValue(h, key, nullptr);
+}
+
+/// Store the Value on `h` at `key`. If `delta` is not null, and
+/// there is already a record for it, then write only the `delta`,
+/// and let RocksDB add it to what is there. See RocksCount.cc
+void RocksStorage::writeValue(const Handle& h, const Handle& key,
+                              const ValuePtr& delta)
 {
 	CHECK_OPEN;
 
-	// k@fid:sid:kid
-	std::string pfx = "k@" + writeAtom(h, false) + ":";
+	// k@sid:fid:kid
+	std::string sid = writeAtom(h, false);
+	std::string pfx = "k@" + sid + ":";
+	std::string fid;
+	auto cfh = _rfile->DefaultColumnFamily();
 	if (_multi_space)
 	{
-		pfx += writeFrame(h->getAtomSpace()) + ":";
+		fid = writeFrame(h->getAtomSpace()) + ":";
+		pfx = keyPrefix(sid, fid);
+		cfh = frameFamily(fid);
+		addToFrame(fid, sid);
+
 		// Clobber any marker that might be present.
-		_rfile->Delete(rocksdb::WriteOptions(), pfx + "+1");
+		_rfile->Delete(rocksdb::WriteOptions(), cfh, pfx + "+1");
 	}
-	pfx += writeAtom(key);
-
-	ValuePtr vp = h->getValue(key);
+	const std::string& kid = writeAtom(key);
+	pfx += kid;
+
+	// Marginals and ordered indexes are declared only for files
+	// without frames. Don't let one be declared in the middle of this.
+	std::shared_lock<std::shared_mutex> dlck(_mtx_declare, std::defer_lock);
+	if (not _multi_space) dlck.lock();
+
+	// Marginals are never kept with frames, so there is only the
+	// one record to look at.
+	const std::string& mid = marginalId(h, kid);
+	std::unique_lock<std::mutex> mlck(_mtx_store_marginal, std::defer_lock);
+	if (0 < mid.size()) mlck.lock();
+
+	// A delta can only be added to a Value that is in this frame.
+	// Otherwise, store all of it. Ordered indexes need to know the
+	// new Value, so they get all of it, too.
+	std::string dummy;
+	if (delta and orderIndexes(kid).empty() and
+	    _rfile->Get(rocksdb::ReadOptions(), cfh, pfx, &dummy).ok())
+	{
+		rocksdb::Status s = _rfile->Merge(rocksdb::WriteOptions(), cfh, pfx,
+			Sexpr::encode_value(delta));
+		if (not s.ok())
+			throw IOException(TRACE_INFO, "Can't merge Value: %s",
+				s.ToString().c_str());
+		if (0 < mid.size())
+			addMarginals(h, mid, FloatValueCast(delta)->value());
+	}
+	else if (0 < mid.size())
+	{
+		mlck.unlock();
+		storeMarginal(mid, h, pfx, h->getValue(key));
+	}
+	else
+		storeValue(cfh, fid, pfx, h->getValue(key));
+	dlck.unlock();
 
-	// First store the value
-	storeValue(pfx, vp);
+	if (_multi_space)
+		updateViews(fid, sid);
 }
 
 /// Backing-store API.
@@ -448,7 +620,15 @@ void RocksStorage::updateValue(const Handle& h, const Handle& key,
 	// to each, we'd be double-counting. That would be unwanted.
 	// So the correct assumption is that the delta has been applied
 	// already, and all we need to do is to save-to-disk.
-	storeValue(h, key);
+	//
+	// With the `?merge-values` URI option, numeric deltas are written
+	// as-is, and RocksDB adds them to the Value on disk. Concurrent
+	// updates from different processes are then not lost.
+	if (_merge_values and delta and
+	    nameserver().isA(delta->get_type(), FLOAT_VALUE))
+		writeValue(h, key, delta);
+	else
+		storeValue(h, key);
 }
 
 /// Append to incoming set.
@@ -462,6 +642,7 @@ void RocksStorage::appendToSidList(const std::string& klist,
 	{
 		sidlist += sid + " ";
 		_rfile->Put(rocksdb::WriteOptions(), klist, sidlist);
+		if (not s.ok()) addCount("C@h@", 1);
 	}
 }
 
@@ -487,10 +668,12 @@ Handle RocksStorage::getAtom(const std::string& sid)
 }
 
 /// Return the Value located at skid.
-ValuePtr RocksStorage::getValue(const std::string& skid)
+ValuePtr RocksStorage::getValue(const std::string& skid,
+                                rocksdb::ColumnFamilyHandle* cfh)
 {
 	std::string sval;
-	rocksdb::Status s = _rfile->Get(rocksdb::ReadOptions(), skid, &sval);
+	if (nullptr == cfh) cfh = _rfile->DefaultColumnFamily();
+	rocksdb::Status s = _rfile->Get(rocksdb::ReadOptions(), cfh, skid, &sval);
 	if (not s.ok())
 		throw IOException(TRACE_INFO, "Internal Error!");
 
@@ -513,12 +696,17 @@ void RocksStorage::loadValue(const Handle& h, const Handle& key)
 	if (0 == sid.size()) return;
 	std::string kid = findAtom(key);
 	if (0 == kid.size()) return;
-	std::string fid;
+	std::string skid = "k@" + sid + ":";
+	auto cfh = _rfile->DefaultColumnFamily();
 	AtomSpace* as = h->getAtomSpace();
 	if (as and _multi_space)
-		fid = ":" + writeFrame(as);
+	{
+		std::string fid = writeFrame(as) + ":";
+		skid = keyPrefix(sid, fid);
+		cfh = frameFamily(fid);
+	}
 
-	ValuePtr vp = getValue("k@" + sid + fid + ":" + kid);
+	ValuePtr vp = getValue(skid + kid, cfh);
 // XXX this is adding to wrong atomspace!?
 	if (as and vp) vp = as->add_atoms(vp);
 	h->setValue(key, vp);
@@ -597,9 +785,10 @@ void RocksStorage::getKeysMonospace(AtomSpace* as,
 }
 
 /// Get all of the key-value pairs for the Atom at `sid`, and place
-/// them on `h`. If there are no pairs, `h` is untouched. If there
-/// are pairs, then *all* existing keys on `h` are deleted, first,
-/// and only then are keys from storage added.
+/// them on `h`, in each of the frames in `frame_order`. In each frame,
+/// if there are no pairs, `h` is untouched. If there are pairs, then
+/// *all* existing keys on `h` are deleted, first, and only then are
+/// keys from storage added.
 ///
 /// The intent of this is to ease bulk loads from storage, where some
 /// upper frames may have Atoms with deleted keys. (An alternaitve
@@ -608,44 +797,57 @@ void RocksStorage::getKeysMonospace(AtomSpace* as,
 /// unexpected, subtle side-effects. It's not clear what the best
 /// answer is; this is the current pragmatic best solution.
 ///
-/// Place the keys into the AtomSpace. Single AtomSpace version.
-void RocksStorage::getKeysMulti(AtomSpace* as,
+/// The records are collected first, and then applied in frame order,
+/// from the bottom up. See getFrameKeys().
+void RocksStorage::getKeysMulti(const FramePath& frame_order,
                                 const std::string& sid, const Handle& h)
 {
-	std::string cid = "k@" + sid + ":" + writeFrame(as) + ":";
+	std::map<uint64_t, KeyVals> frame_keys;
+	getFrameKeys(sid, frame_order, frame_keys);
+
+	for (const auto& fk : frame_keys)
+	{
+		AtomSpace* as = (AtomSpace*) frame_order.at(fk.first).get();
+		applyFrameKeys(as, fk.second, h);
+	}
+}
 
+/// Place the kid/sval pairs `kvs`, all from one frame, onto `h` in
+/// the AtomSpace `as`. See getKeysMulti() for the rules.
+void RocksStorage::applyFrameKeys(AtomSpace* as, const KeyVals& kvs,
+                                  const Handle& h)
+{
 	Handle hv;
-	// Iterate over all the keys on the Atom.
-	size_t kidoff = cid.size();
-	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
-	for (it->Seek(cid); it->Valid() and it->key().starts_with(cid); it->Next())
+	for (const auto& kv : kvs)
 	{
-		const std::string& rks = it->key().ToString();
+		const std::string& skey = kv.first;
 
 		// Check for Atoms marked as deleted. Mark them up
 		// in the corresponding AtomSpace as well. There will
-		// be only one per frame, so we can return immediately.
-		if ('-' == rks[kidoff])
+		// be only one per frame, so we are done with the frame.
+		if ('-' == skey[0])
 		{
 			bool extracted = as->extract_atom(h, true);
 			if (not extracted)
 				throw IOException(TRACE_INFO, "Internal Error!");
-			delete it;
-			return;
+			break;
 		}
 
 		// If there is just a + instead of a key, this means that
 		// the atom is in this frame, but has no keys on it. Insert
-		// into frame, and return. There can never be more than one
-		// of these per frame, so we return immediately.
-		if ('+' == rks[kidoff])
+		// into frame, and move on. There can never be more than one
+		// of these per frame. If it is marked -, then it was deleted
+		// in some frame that was squashed into this one; hide what
+		// is underneath, first, just as if that frame was still there.
+		if ('+' == skey[0])
 		{
+			if (0 < kv.second.size() and '-' == kv.second[0])
+				as->extract_atom(h, true);
 			as->add_atom(h);
-			delete it;
-			return;
+			break;
 		}
 
-		Handle key = getAtom(rks.substr(kidoff));
+		Handle key = getAtom(skey);
 		key = as->add_atom(key);
 
 		// Check for flag marker predicates and restore the flags.
@@ -666,7 +868,7 @@ void RocksStorage::getKeysMulti(AtomSpace* as,
 		}
 
 		size_t junk = 0;
-		ValuePtr vp = Sexpr::decode_value(it->value().ToString(), junk);
+		ValuePtr vp = Sexpr::decode_value(kv.second, junk);
 		if (vp) vp = as->add_atoms(vp);
 
 		// hv is null first time through the loop.
@@ -679,7 +881,6 @@ void RocksStorage::getKeysMulti(AtomSpace* as,
 		}
 		as->set_value(hv, key, vp);
 	}
-	delete it;
 }
 
 /// Backend callback - get the Atom
@@ -695,20 +896,22 @@ void RocksStorage::getAtom(const Handle& h)
 		return;
 	}
 
-	// When there are multiple spaces, a directory listing of all of
-	// them is required, so that individual Atom loads end up in the
-	// correct AtomSpaces. Load this now, if its not already available.
-	if (0 == _fid_map.size())
-		loadFrameDAG();
-
 	// For multi-spaces, determine the path-DAG from the top space
 	// to the bottom, and load from the bottom-up.
-	FramePath frame_order = getPath(HandleCast(h->getAtomSpace()));
-	for (const auto& frit: frame_order)
+	AtomSpace* as = h->getAtomSpace();
+	FramePathPtr ppath = getPath(HandleCast(as));
+	const FramePath& frame_order = *ppath;
+
+	// If there's a materialized view for this frame, use it.
+	const std::string& vid = viewPrefix(as);
+	if (0 < vid.size())
 	{
-		AtomSpace* as = (AtomSpace*) frit.second.get();
-		getKeysMulti(as, sid, h);
+		getKeysView(as, frame_order, vid, sid, h);
+		return;
 	}
+
+	if (not inPath(frame_order, sid)) return;
+	getKeysMulti(frame_order, sid, h);
 }
 
 /// Backend callback - find the Link. This is used ONLY to implement
@@ -797,6 +1000,18 @@ Handle RocksStorage::findAlpha(const Handle& h, const std::string& shash,
 // =========================================================
 // Remove-related stuff...
 
+/// Return true if `satom` is an s-expression for an Atom of exactly
+/// the type named `tname`. The leading hash, if any, is skipped.
+static bool is_of_type(const std::string& satom, const std::string& tname)
+{
+	size_t paren = satom.find('(');
+	if (std::string::npos == paren) return false;
+	if (satom.compare(paren+1, tname.size(), tname)) return false;
+	char c = satom[paren + 1 + tname.size()];
+	return ' ' == c or ')' == c;
+}
+
+
 void RocksStorage::removeAtom(AtomSpace* frame, const Handle& h, bool recursive)
 {
 	AtomSpace* has = h->getAtomSpace();
@@ -814,6 +1029,7 @@ void RocksStorage::removeAtom(AtomSpace* frame, const Handle& h, bool recursive)
 
 	if (not _multi_space)
 	{
+		std::shared_lock<std::shared_mutex> dlck(_mtx_declare);
 		doRemoveAtom(h, recursive);
 		return;
 	}
@@ -835,12 +1051,6 @@ void RocksStorage::doRemoveAtom(const Handle& h, bool recursive)
 	// Refuse to delete atoms that are in use as keys or messages.
 	if (h->isKey() or h->isMessage()) return;
 
-#ifdef HAVE_DELETE_RANGE
-	rocksdb::Slice start, end;
-	_rfile->DeleteRange(rocksdb::WriteOptions(), start, end);
-
-#endif
-
 	// Are we even holding the Atom to be deleted?
 	bool convertible = nameserver().isA(h->get_type(), ALPHA_CONVERTIBLE_SIG);
 	std::string sid;
@@ -870,13 +1080,9 @@ void RocksStorage::doRemoveAtom(const Handle& h, bool recursive)
 	removeSatom(satom, sid, h->is_node(), recursive);
 }
 
-/// Remove `sid` from the incoming set of `osatom`.
-/// Assumes that `sid` references an Atom that has `osatom`
-/// in it's outgoing set.   Assumes that `stype` is the type
-/// of `sid`.
-void RocksStorage::remIncoming(const std::string& sid,
-                               const std::string& stype,
-                               const std::string& osatom)
+/// Find the sid of the Atom `osatom`, which is an s-expression,
+/// possibly with a hash in front of it.
+std::string RocksStorage::findSatom(const std::string& osatom)
 {
 	// Oh bother. Is it a Node, or a Link?
 	// Skip over leading hash, if needed.
@@ -888,11 +1094,7 @@ void RocksStorage::remIncoming(const std::string& sid,
 	// Get the matching osid
 	std::string osid;
 	_rfile->Get(rocksdb::ReadOptions(), opf + osatom.substr(paren), &osid);
-
-	// Get the incoming set. Since we have the type, we can get this
-	// directly, without needing any loops.
-	std::string ist = "i@" + osid + ":" + stype;
-	remFromInset(ist, sid);
+	return osid;
 }
 
 /// Remove `sid` from the list of sids stored at `klist`.
@@ -929,11 +1131,96 @@ void RocksStorage::remFromSidList(const std::string& klist,
 	// from it, and store it as the new sidlist. Unless its empty...
 	sidlist.replace(pos, sidlen, "");
 	if (0 == sidlist.size())
+	{
 		_rfile->Delete(rocksdb::WriteOptions(), klist);
+		addCount("C@h@", -1);
+	}
 	else
 		_rfile->Put(rocksdb::WriteOptions(), klist, sidlist);
 }
 
+/// Return the distinct Atoms in the outgoing set of the Link
+/// `satom`, as s-expressions. The outgoing set starts at `pos`.
+static std::set<std::string> outgoing_satoms(const std::string& satom,
+                                             size_t pos)
+{
+	// Loop over the outgoing set of `satom`.
+	// Deduplicate the set by using std::set<>
+	std::set<std::string> soset;
+	size_t l = pos;
+	size_t e = satom.size() - 1;
+	while (l < e)
+	{
+		size_t r = e;
+		int pcnt = Sexpr::get_next_expr(satom, l, r, 0);
+		if (0 < pcnt or l == r) break;
+		r++;
+
+		// osatom is an atom in the outgoing set of satom
+		soset.insert(satom.substr(l, r-l));
+
+		l = r;
+	}
+	return soset;
+}
+
+/// Return the distinct sids in the outgoing set of the Link `sid`,
+/// which is `satom`. These are kept in the `s@sid:` record; DB's
+/// older than version 4 might not have it, in which case the satom
+/// is taken apart and each Atom in it is looked up. Either way, each
+/// sid appears once, so that the incoming-set counts are decremented
+/// once per distinct Atom, just as `writeAtom()` incremented them.
+std::vector<std::string> RocksStorage::outgoingSids(const std::string& sid,
+                                                    const std::string& satom)
+{
+	std::set<std::string> osids;
+	std::string sidlist;
+	if (_rfile->Get(rocksdb::ReadOptions(), "s@" + sid + ":", &sidlist).ok())
+	{
+		std::stringstream ss(sidlist);
+		std::string osid;
+		while (ss >> osid)
+			osids.insert(osid);
+		return std::vector<std::string>(osids.begin(), osids.end());
+	}
+
+	// Different s-expressions can resolve to the same Atom, and Atoms
+	// that can't be found have no incoming set to fix up.
+	size_t pos = satom.find_first_of(" )", satom.find('('));
+	for (const std::string& osatom : outgoing_satoms(satom, pos))
+	{
+		const std::string& osid = findSatom(osatom);
+		if (0 < osid.size()) osids.insert(osid);
+	}
+	return std::vector<std::string>(osids.begin(), osids.end());
+}
+
+/// Write the `s@sid:` record for every Link. Needed only when
+/// upgrading DB's older than version 4.
+void RocksStorage::indexOutgoing(void)
+{
+	size_t cnt = 0;
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("l@"); it->Valid() and it->key().starts_with("l@"); it->Next())
+	{
+		const std::string& satom = it->key().ToString().substr(2);
+		size_t pos = satom.find_first_of(" )");
+		std::string sidlist;
+		for (const std::string& osatom : outgoing_satoms(satom, pos))
+		{
+			const std::string& osid = findSatom(osatom);
+			if (0 == osid.size()) { sidlist.clear(); break; }
+			sidlist += osid + " ";
+		}
+		if (0 == sidlist.size()) continue;
+		_rfile->Put(rocksdb::WriteOptions(),
+			"s@" + it->value().ToString() + ":", sidlist);
+		cnt++;
+	}
+	delete it;
+	printf("Rocks: indexed %zu outgoing sets.\n", cnt);
+}
+
 /// Remove the given Atom from the database.
 /// The Atom is encoded both as `satom` (the s-expression)
 /// and also as `sid` (the matching Atom ID).
@@ -995,26 +1282,9 @@ void RocksStorage::removeSatom(const std::string& satom,
 			// stype is the string-type of the Link.
 			const std::string& stype = satom.substr(paren+1, pos-paren-1);
 
-			// Loop over the outgoing set of `satom`.
-			// Deduplicate the set by using std::set<>
-			std::set<std::string> soset;
-			size_t l = pos;
-			size_t e = satom.size() - 1;
-			while (l < e)
-			{
-				size_t r = e;
-				int pcnt = Sexpr::get_next_expr(satom, l, r, 0);
-				if (0 < pcnt or l == r) break;
-				r++;
-
-				// osatom is an atom in the outgoing set of satom
-				soset.insert(satom.substr(l, r-l));
-
-				l = r;
-			}
-
-			// Perform the deduplicated delete.
-			for (const std::string& osatom : soset)
+			// Perform the deduplicated delete. Since we have the type,
+			// the incoming set entries can be found directly.
+			for (const std::string& osid : outgoingSids(sid, satom))
 			{
 				// Two different threads may be racing to delete the same
 				// atom. If so, the second thread loses and throws a
@@ -1022,7 +1292,7 @@ void RocksStorage::removeSatom(const std::string& satom,
 				// the error here. Triggered by MultiDeleteUTest.
 				try
 				{
-					remIncoming(sid, stype, osatom);
+					remFromInset("i@" + osid + ":" + stype, sid);
 				}
 				catch(const NotFoundException& ex)
 				{
@@ -1035,27 +1305,446 @@ void RocksStorage::removeSatom(const std::string& satom,
 		}
 	}
 
-	// Delete the Atom, next.
+	// Delete the Atom, next. Two threads may be racing to delete
+	// it; only the first one gets to count it. The records and the
+	// counts all go in one batch.
+	std::lock_guard<std::mutex> slck(sidLock(sid));
+	std::string dummy;
+	if (not _rfile->Get(rocksdb::ReadOptions(), "a@" + sid + ":", &dummy).ok())
+		return;
+
+	rocksdb::WriteBatch batch;
 	std::string pfx = is_node ? "n@" : "l@";
-	_rfile->Delete(rocksdb::WriteOptions(), pfx + satom.substr(paren));
-	_rfile->Delete(rocksdb::WriteOptions(), "a@" + sid + ":");
+	batch.Delete(pfx + satom.substr(paren));
+	batch.Delete("a@" + sid + ":");
+	if (not is_node)
+		batch.Delete("s@" + sid + ":");
+	countAtom(batch, satom, is_node, -1);
 
-	// Delete all values hanging on the atom ...
+	// Delete all values hanging on the atom ... They have to be
+	// looked at, to keep the counts and indexes, but they are
+	// contiguous, and so are deleted all at once.
+	int64_t nvals = 0;
 	pfx = "k@" + sid + ":";
 	it = _rfile->NewIterator(rocksdb::ReadOptions());
 	for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
-		_rfile->Delete(rocksdb::WriteOptions(), it->key());
+	{
+		const std::string& kkey = it->key().ToString();
+		size_t colon = kkey.rfind(':');
+		char c = kkey[colon + 1];
+		if ('+' != c and '-' != c)
+		{
+			nvals++;
+			if (_key_index) unindexKey(batch, kkey);
+		}
+		if (not _multi_space)
+		{
+			const std::string& kid = kkey.substr(colon + 1);
+			const std::string& sval = it->value().ToString();
+			removeOrdered(batch, sid, kid, sval);
+			if (not is_node) removeMarginal(satom, kid, sval);
+		}
+	}
+	delete it;
+	batch.DeleteRange(pfx, prefix_end(pfx));
+	addCount(batch, "C@k@", -nvals);
+
+	// Nothing is left to sum over.
+	std::string mkey = "M@" + sid + ":";
+	batch.DeleteRange(mkey, prefix_end(mkey));
+
+	// The incoming set is gone, so its size is zero. Anything left
+	// over from racing deletes goes too.
+	std::string ikey = "i@" + sid + ":";
+	batch.DeleteRange(ikey, prefix_end(ikey));
+	ikey = "I@" + sid + ":";
+	batch.DeleteRange(ikey, prefix_end(ikey));
+
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
+}
+
+/// Add the deletes for the Atom `sid`, which is `satom`, to `batch`,
+/// and the changes to the counters to `counts`. The incoming sets of
+/// the Atoms it holds are fixed up, except for those in `doomed`;
+/// these are assumed to be going away, too. The hash bucket, if any,
+/// is not touched. Must be called with the locks for `doomed` held;
+/// see lockSids().
+void RocksStorage::batchRemove(rocksdb::WriteBatch& batch,
+                               std::map<std::string, int64_t>& counts,
+                               const std::string& sid,
+                               const std::string& satom,
+                               const std::set<std::string>& doomed)
+{
+	size_t paren = satom.find('(');
+	size_t pos = satom.find_first_of(" )", paren);
+	const std::string& stype = satom.substr(paren+1, pos-paren-1);
+	bool is_node = nameserver().isNode(nameserver().getType(stype));
+
+	if (not is_node)
+	{
+		for (const std::string& osid : outgoingSids(sid, satom))
+		{
+			// The incoming sets of doomed Atoms go all at once.
+			counts["C@i@"] --;
+			if (doomed.end() != doomed.find(osid)) continue;
+
+			std::string ist = "i@" + osid + ":" + stype;
+			batch.Delete(ist + "-" + sid);
+			counts["I@" + ist.substr(2)] --;
+			counts["I@" + osid + ":"] --;
+		}
+	}
+
+	// The Values have to be looked at, to keep the indexes.
+	std::string pfx = "k@" + sid + ":";
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
+	{
+		const std::string& kkey = it->key().ToString();
+		const std::string& kid = kkey.substr(kkey.rfind(':') + 1);
+		const std::string& sval = it->value().ToString();
+		counts["C@k@"] --;
+		if (_key_index) unindexKey(batch, kkey);
+		removeOrdered(batch, sid, kid, sval);
+		if (not is_node) removeMarginal(satom, kid, sval);
+	}
 	delete it;
+
+	batch.Delete((is_node ? "n@" : "l@") + satom.substr(paren));
+	batch.Delete("a@" + sid + ":");
+	if (not is_node) batch.Delete("s@" + sid + ":");
+	for (const char* rng : {"k@", "i@", "I@", "M@"})
+	{
+		std::string rpfx = rng + sid + ":";
+		batch.DeleteRange(rpfx, prefix_end(rpfx));
+	}
+
+	counts["C@t:" + stype] --;
+	counts["C@a@"] --;
+	counts[is_node ? "C@n@" : "C@l@"] --;
+}
+
+/// Remove all Atoms of exactly the type `t` from storage, together
+/// with their Values. If `recursive` is set, then the Links holding
+/// them are removed too; otherwise, the Atoms that have an incoming
+/// set are kept. Atoms that are in use as keys or messages are kept.
+/// Returns the number of Atoms of type `t` that were removed.
+///
+/// This does the same thing as removing the Atoms one at a time, but
+/// much faster: the type is scanned once, the records for each Atom
+/// are deleted with DeleteRange, the incoming sets of the Atoms they
+/// hold are fixed up in batches, and the counters are updated once.
+/// It should not be run while other threads are writing.
+size_t RocksStorage::deleteType(Type t, bool recursive)
+{
+	CHECK_OPEN;
+	if (_multi_space)
+		throw IOException(TRACE_INFO,
+			"Deleting types is not supported for files holding frames!");
+
+	std::shared_lock<std::shared_mutex> dlck(_mtx_declare);
+	bool is_node = nameserver().isNode(t);
+	const std::string& tname = nameserver().getTypeName(t);
+	const std::string& kflag =
+		findAtom(createNode(PREDICATE_NODE, "*-IsKeyFlag-*"));
+	const std::string& mflag =
+		findAtom(createNode(PREDICATE_NODE, "*-IsMessageFlag-*"));
+
+	// Find the doomed Atoms.
+	std::set<std::string> doomed;
+	std::string typ = (is_node ? "n@(" : "l@(") + tname;
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek(typ); it->Valid() and it->key().starts_with(typ); it->Next())
+	{
+		if (not is_of_type(it->key().ToString().substr(2), tname)) continue;
+
+		std::string dummy;
+		const std::string& sid = it->value().ToString();
+		if ((0 < kflag.size() and _rfile->Get(rocksdb::ReadOptions(),
+		         "k@" + sid + ":" + kflag, &dummy).ok()) or
+		    (0 < mflag.size() and _rfile->Get(rocksdb::ReadOptions(),
+		         "k@" + sid + ":" + mflag, &dummy).ok()))
+			continue;
+
+		doomed.insert(sid);
+	}
+	delete it;
+
+	// Chop away the incoming sets. Links of type `t` are left for
+	// below; anything else is removed the usual way.
+	std::vector<std::string> kept;
+	for (const std::string& sid : doomed)
+	{
+		std::string ist = "i@" + sid + ":";
+		size_t istlen = ist.size();
+		it = _rfile->NewIterator(rocksdb::ReadOptions());
+		for (it->Seek(ist); it->Valid() and it->key().starts_with(ist); it->Next())
+		{
+			if (not recursive)
+			{
+				kept.push_back(sid);
+				break;
+			}
+
+			const std::string& frag = it->key().ToString().substr(istlen);
+			const std::string& isid = frag.substr(frag.find('-') + 1);
+			if (doomed.end() != doomed.find(isid)) continue;
+
+			std::string isatom;
+			_rfile->Get(rocksdb::ReadOptions(), "a@" + isid + ":", &isatom);
+			if (0 < isatom.size())
+				removeSatom(isatom, isid, false, true);
+		}
+		delete it;
+	}
+	for (const std::string& sid : kept)
+		doomed.erase(sid);
+	size_t ndoomed = doomed.size();
+
+	// Now the Atoms themselves.
+	std::vector<std::unique_lock<std::mutex>> slcks;
+	lockSids(doomed, slcks);
+	std::map<std::string, int64_t> counts;
+	rocksdb::WriteBatch batch;
+	for (const std::string& sid : doomed)
+	{
+		std::string satom;
+		if (not _rfile->Get(rocksdb::ReadOptions(), "a@" + sid + ":", &satom).ok())
+			continue;
+
+		size_t paren = satom.find('(');
+		if (0 < paren)
+			remFromSidList(satom.substr(0, paren), sid);
+
+		batchRemove(batch, counts, sid, satom, doomed);
+		if (CLEAN_BATCH_SIZE < batch.Count())
+		{
+			_rfile->Write(rocksdb::WriteOptions(), &batch);
+			batch.Clear();
+		}
+	}
+	for (const auto& cpr : counts)
+		addCount(batch, cpr.first, cpr.second);
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
+
+	// Some of the doomed Links may have been removed with the
+	// incoming sets, above.
+	return ndoomed;
+}
+
+/// Remove all of the Atoms in `hs` from storage, in one go. If
+/// `recursive` is set, then everything holding them is removed too;
+/// otherwise, Atoms that are held by Links that are not being removed
+/// are kept. Atoms that are in use as keys or messages are kept.
+///
+/// In the single-space case, the Atoms, their Values and the fixups
+/// to the incoming sets of the Atoms they hold are all written in one
+/// WriteBatch, and so are removed atomically. (The marginals are
+/// updated ahead of that.) In the multi-space case, the Atoms are
+/// hidden in `frame`, as in removeAtom(), but each one only once, no
+/// matter how many of the others hold it; the markers that hide them
+/// are all written in one WriteBatch, too.
+void RocksStorage::removeAtoms(AtomSpace* frame, const HandleSeq& hs,
+                               bool recursive)
+{
+	CHECK_OPEN;
+
+	if (_multi_space)
+	{
+		// Gather the closure, deduplicated.
+		HandleSet doomed;
+		HandleSeq todo;
+		for (const Handle& h : hs)
+			if (not h->isKey() and not h->isMessage()) todo.push_back(h);
+		while (0 < todo.size())
+		{
+			Handle h = todo.back();
+			todo.pop_back();
+			if (not doomed.insert(h).second) continue;
+			if (not recursive) continue;
+			for (const Handle& hi: h->getIncomingSet())
+				todo.push_back(hi);
+		}
+
+		// The Atoms are written first, so that they have sids. Then
+		// the markers that hide them, their frame membership and its
+		// count all go in one batch.
+		std::string fidc = writeFrame(frame) + ":";
+		auto cfh = frameFamily(fidc);
+		std::set<std::string> sids;
+		for (const Handle& h : doomed)
+			sids.insert(writeAtom(h, false));
+
+		std::vector<std::unique_lock<std::mutex>> slcks;
+		lockSids(sids, slcks);
+		rocksdb::WriteBatch batch;
+		std::vector<std::string> added;
+		for (const std::string& sid : sids)
+		{
+			std::string oid = memberPrefix(fidc) + sid;
+			std::string dummy;
+			if (not _rfile->Get(rocksdb::ReadOptions(), cfh, oid, &dummy).ok())
+			{
+				batch.Put(cfh, oid, "");
+				added.push_back(sid);
+			}
+
+			std::string skid = keyPrefix(sid, fidc);
+			batch.Delete(cfh, skid + "+1");
+			batch.Put(cfh, skid + "-1", "");
+		}
+		if (0 < added.size())
+			addCount(batch, "c@" + fidc + "a", added.size());
+
+		rocksdb::Status s = _rfile->Write(rocksdb::WriteOptions(), &batch);
+		if (not s.ok())
+			throw IOException(TRACE_INFO, "Can't remove Atoms: %s",
+				s.ToString().c_str());
+		slcks.clear();
+
+		for (const std::string& sid : added)
+			addToFilter(fidc, sid);
+		for (const std::string& sid : sids)
+			updateViews(fidc, sid);
+		return;
+	}
+
+	for (const Handle& h : hs)
+	{
+		AtomSpace* has = h->getAtomSpace();
+		if (has and has != frame)
+			throw IOException(TRACE_INFO,
+				"Attempting to delete %s from %s, "
+				"Did you forget to say `store-frames` first?",
+				h->to_string().c_str(), frame->get_name().c_str());
+	}
+	std::shared_lock<std::shared_mutex> dlck(_mtx_declare);
+
+	// Gather the closure, from the incoming sets in storage.
+	std::map<std::string, std::string> satoms;
+	std::vector<std::string> todo;
+	for (const Handle& h : hs)
+	{
+		// Refuse to delete atoms that are in use as keys or messages.
+		if (h->isKey() or h->isMessage()) continue;
+		const std::string& sid = findAtom(h);
+		if (0 < sid.size()) todo.push_back(sid);
+	}
+	while (0 < todo.size())
+	{
+		std::string sid = todo.back();
+		todo.pop_back();
+		if (satoms.end() != satoms.find(sid)) continue;
+
+		std::string satom;
+		if (not _rfile->Get(rocksdb::ReadOptions(), "a@" + sid + ":", &satom).ok())
+			continue;
+		satoms[sid] = satom;
+		if (not recursive) continue;
+
+		std::string ist = "i@" + sid + ":";
+		size_t istlen = ist.size();
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+		for (it->Seek(ist); it->Valid() and it->key().starts_with(ist); it->Next())
+		{
+			const std::string& frag = it->key().ToString().substr(istlen);
+			todo.push_back(frag.substr(frag.find('-') + 1));
+		}
+		delete it;
+	}
+
+	std::set<std::string> doomed;
+	for (const auto& spr : satoms)
+		doomed.insert(spr.first);
+
+	// Without recursion, anything held by a Link that stays, stays.
+	// Keeping one Atom may mean keeping the ones it holds; repeat
+	// until nothing changes.
+	bool changed = not recursive;
+	while (changed)
+	{
+		changed = false;
+		for (auto dit = doomed.begin(); dit != doomed.end(); )
+		{
+			bool held = false;
+			std::string ist = "i@" + *dit + ":";
+			size_t istlen = ist.size();
+			auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+			for (it->Seek(ist); it->Valid() and it->key().starts_with(ist); it->Next())
+			{
+				const std::string& frag = it->key().ToString().substr(istlen);
+				if (doomed.end() == doomed.find(frag.substr(frag.find('-') + 1)))
+				{
+					held = true;
+					break;
+				}
+			}
+			delete it;
+
+			if (held)
+			{
+				dit = doomed.erase(dit);
+				changed = true;
+			}
+			else dit++;
+		}
+	}
+
+	std::vector<std::unique_lock<std::mutex>> slcks;
+	lockSids(doomed, slcks);
+	std::map<std::string, int64_t> counts;
+	std::map<std::string, std::set<std::string>> buckets;
+	rocksdb::WriteBatch batch;
+	for (const std::string& sid : doomed)
+	{
+		const std::string& satom = satoms[sid];
+		size_t paren = satom.find('(');
+		if (0 < paren)
+			buckets[satom.substr(0, paren)].insert(sid);
+
+		batchRemove(batch, counts, sid, satom, doomed);
+	}
+
+	// Take the doomed sids out of the hash buckets.
+	for (const auto& bpr : buckets)
+	{
+		std::string sidlist;
+		_rfile->Get(rocksdb::ReadOptions(), bpr.first, &sidlist);
+
+		std::string kept;
+		std::stringstream ss(sidlist);
+		std::string bsid;
+		while (ss >> bsid)
+			if (bpr.second.end() == bpr.second.find(bsid))
+				kept += bsid + " ";
+
+		if (0 == kept.size())
+		{
+			batch.Delete(bpr.first);
+			counts["C@h@"] --;
+		}
+		else
+			batch.Put(bpr.first, kept);
+	}
+
+	for (const auto& cpr : counts)
+		addCount(batch, cpr.first, cpr.second);
+
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
 }
 
 // =========================================================
 // Work with the incoming set
 
+/// Add `sid` to the incoming set at `klist`, which must be of the
+/// form `i@osid:stype`. Must be called only once for each Link.
 void RocksStorage::appendToInset(const std::string& klist,
                                  const std::string& sid)
 {
-	std::string key = klist + "-" + sid;
-	rocksdb::Status s = _rfile->Put(rocksdb::WriteOptions(), key, "");
+	rocksdb::WriteBatch batch;
+	batch.Put(klist + "-" + sid, "");
+	countIncoming(batch, klist, 1);
+	rocksdb::Status s = _rfile->Write(rocksdb::WriteOptions(), &batch);
 	if (not s.ok())
 		throw IOException(TRACE_INFO, "Internal Error!");
 }
@@ -1064,7 +1753,18 @@ void RocksStorage::remFromInset(const std::string& klist,
                                 const std::string& sid)
 {
 	std::string key = klist + "-" + sid;
-	rocksdb::Status s = _rfile->Delete(rocksdb::WriteOptions(), key);
+
+	// Count it only if it's really there. The lock is that of the
+	// Link, which is the one being deleted.
+	std::lock_guard<std::mutex> slck(sidLock(sid));
+	std::string dummy;
+	if (not _rfile->Get(rocksdb::ReadOptions(), key, &dummy).ok())
+		return;
+
+	rocksdb::WriteBatch batch;
+	batch.Delete(key);
+	countIncoming(batch, klist, -1);
+	rocksdb::Status s = _rfile->Write(rocksdb::WriteOptions(), &batch);
 	if (not s.ok())
 		throw IOException(TRACE_INFO, "Internal Error!");
 }
@@ -1078,9 +1778,11 @@ void RocksStorage::loadInset(AtomSpace* as, const std::string& ist)
 	size_t offset = -1;
 	if ('-' == ist[istlen - 1]) offset = 0;
 
-	FramePath frame_order;
+	FramePathPtr ppath = _multi_space ? getPath(HandleCast(as)) : noPath();
+	const FramePath& frame_order = *ppath;
+	std::string vid;
 	if (_multi_space)
-		frame_order = getPath(HandleCast(HandleCast(as)));
+		vid = viewPrefix(as);
 
 	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
 	for (it->Seek(ist); it->Valid() and it->key().starts_with(ist); it->Next())
@@ -1091,6 +1793,9 @@ void RocksStorage::loadInset(AtomSpace* as, const std::string& ist)
 		if (0 != offset) offset = frag.find('-') + 1;
 		const std::string& sid = frag.substr(offset);
 
+		// Don't bother, if it's not in any of the frames.
+		if (_multi_space and not inPath(frame_order, sid)) continue;
+
 		Handle hi = getAtom(sid);
 		if (not _multi_space)
 		{
@@ -1100,11 +1805,10 @@ void RocksStorage::loadInset(AtomSpace* as, const std::string& ist)
 		}
 
 		// If we are here, its a multi-space fetch.
-		for (const auto& frit: frame_order)
-		{
-			AtomSpace* fas = (AtomSpace*) frit.second.get();
-			getKeysMulti(fas, sid, hi);
-		}
+		if (0 < vid.size())
+			getKeysView(as, frame_order, vid, sid, hi);
+		else
+			getKeysMulti(frame_order, sid, hi);
 	}
 	delete it;
 }
@@ -1177,13 +1881,10 @@ size_t RocksStorage::loadAtomsPfx(
 	{
 		cnt ++;
 		try {
-			Handle h = Sexpr::decode_atom(it->key().ToString().substr(2));
 			const std::string& sid = it->value().ToString();
-			for (const auto& frit: frame_order)
-			{
-				AtomSpace* as = (AtomSpace*) frit.second.get();
-				getKeysMulti(as, sid, h);
-			}
+			if (not inPath(frame_order, sid)) continue;
+			Handle h = Sexpr::decode_atom(it->key().ToString().substr(2));
+			getKeysMulti(frame_order, sid, h);
 		} catch (const SyntaxException& ex) {
 			// This will happen if a Type is unknown. Either the user forgot
 			// to load the module that defines that type, or this is an old
@@ -1221,11 +1922,7 @@ size_t RocksStorage::loadAtomsHeight(
 			Handle h = Sexpr::decode_atom(satom, pos);
 
 			// Load the values, in frame-DAG order.
-			for (const auto& frit: frame_order)
-			{
-				AtomSpace* as = (AtomSpace*) frit.second.get();
-				getKeysMulti(as, sid, h);
-			}
+			getKeysMulti(frame_order, sid, h);
 		} catch (const SyntaxException& ex) {
 			// This will happen if a Type is unknown. Either the user forgot
 			// to load the module that defines that type, or this is an old
@@ -1239,21 +1936,70 @@ size_t RocksStorage::loadAtomsHeight(
 	return cnt;
 }
 
+/// Load all Atoms that are members of the frames in `frame_order`.
+/// Membership is found with the `o@fid:` index, so the cost is
+/// proportional to the size of the frames, and not to the size of
+/// the whole DB. The Atoms are loaded in order of increasing height,
+/// so that Links do not hide Atoms lower in the frame stack.
+void RocksStorage::loadFrameMembers(const FramePath& frame_order)
+{
+	// An Atom may be a member of several frames; dedupe.
+	std::vector<std::string> members;
+	for (const auto& frit: frame_order)
+		getFrameMembers(aidtostr(frit.first) + ":", members);
+	std::unordered_set<std::string> sids(members.begin(), members.end());
+
+	std::map<size_t, std::vector<std::pair<std::string, Handle>>> by_height;
+	for (const std::string& sid : sids)
+	{
+		// The Atom might have been scrubbed away, leaving behind
+		// a stale index entry.
+		std::string satom;
+		rocksdb::Status s = _rfile->Get(rocksdb::ReadOptions(),
+			"a@" + sid + ":", &satom);
+		if (not s.ok()) continue;
+
+		try {
+			size_t pos = satom.find('('); // skip over hash, if present
+			Handle h = Sexpr::decode_atom(satom, pos);
+			by_height[getHeight(h)].push_back({sid, h});
+		} catch (const SyntaxException& ex) {
+			// This will happen if a Type is unknown. Either the user forgot
+			// to load the module that defines that type, or this is an old
+			// dataset that contains an obsolete type. Either way, a loud warning.
+			logger().warn("RocksStorage: %s\n", ex.get_message());
+			_unknown_type = true;
+		}
+	}
+
+	for (const auto& hei : by_height)
+		for (const auto& pr : hei.second)
+			getKeysMulti(frame_order, pr.first, pr.second);
+}
+
 /// Load all Atoms in a specific frame.
 void RocksStorage::loadAtomsAllFrames(AtomSpace* as)
 {
 	if (not _multi_space)
 		throw IOException(TRACE_INFO, "Internal Error!");
 
-	FramePath frame_order = getPath(HandleCast(HandleCast(as)));
-	loadAtomsPfx(frame_order, "n@");
+	FramePathPtr ppath = getPath(HandleCast(as));
+	const FramePath& frame_order = *ppath;
 
-	size_t height = 1;
-	while (true)
+	// Use the frame membership index, if we've got a complete one.
+	if (_frame_index)
+		loadFrameMembers(frame_order);
+	else
 	{
-		size_t found = loadAtomsHeight(frame_order, height);
-		if (0 == found) break;
-		height ++;
+		loadAtomsPfx(frame_order, "n@");
+
+		size_t height = 1;
+		while (true)
+		{
+			size_t found = loadAtomsHeight(frame_order, height);
+			if (0 == found) break;
+			height ++;
+		}
 	}
 
 	if (_unknown_type)
@@ -1273,15 +2019,116 @@ void RocksStorage::loadAtomSpace(AtomSpace* table)
 		return;
 	}
 
-	// When there are multiple spaces, a directory listing of all of
-	// them is required, so that individual Atom loads end up in the
-	// correct AtomSpaces. Load this now, if its not already available.
-	if (0 == _fid_map.size())
-		loadFrameDAG();
-
 	loadAtomsAllFrames(table);
 }
 
+/// Load up to `budget` Atoms, starting at `cursor`, and return the
+/// cursor at which to resume. An empty cursor means "start at the
+/// beginning"; an empty return value means that the load is done.
+///
+/// The cursor is just the DB key of the next record to be read, so
+/// it can be saved and used to restart a load after an interruption.
+/// In the single-space case, this is a key in the `a@` range. In the
+/// multi-space case, it is a key in the `n@` range, or in one of the
+/// `zN@` height ranges; these are walked in the same order as in
+/// loadAtomsAllFrames(), so that Links are loaded after everything
+/// they contain. If the DB is written to in between chunks, Atoms
+/// stored behind the cursor will be missed. A zero `budget` would
+/// never advance the cursor, and is rejected.
+std::string RocksStorage::loadAtomSpaceChunk(AtomSpace* as,
+                                             const std::string& cursor,
+                                             size_t budget)
+{
+	CHECK_OPEN;
+
+	if (0 == budget)
+		throw IOException(TRACE_INFO, "Load chunk size must be positive");
+
+	FramePathPtr ppath = _multi_space ? getPath(HandleCast(as)) : noPath();
+	const FramePath& frame_order = *ppath;
+	std::string start = cursor;
+	if (_multi_space)
+	{
+		if (0 == start.size()) start = "n@";
+	}
+	else if (0 == start.size()) start = "a@";
+
+	bool ok = _multi_space ?
+		(0 == start.compare(0, 2, "n@") or 'z' == start[0]) :
+		(0 == start.compare(0, 2, "a@"));
+	if (not ok or std::string::npos == start.find('@'))
+		throw IOException(TRACE_INFO, "Invalid load cursor '%s'",
+			start.c_str());
+
+	size_t cnt = 0;
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	it->Seek(start);
+	while (true)
+	{
+		// One of `a@`, `n@` or `zN@`
+		std::string pfx = start.substr(0, start.find('@') + 1);
+		for (; it->Valid() and it->key().starts_with(pfx); it->Next())
+		{
+			if (budget <= cnt)
+			{
+				std::string next = it->key().ToString();
+				delete it;
+				return next;
+			}
+			cnt ++;
+
+			try {
+				if ('a' == pfx[0])
+				{
+					std::string satom = it->value().ToString();
+					size_t pos = satom.find('('); // skip over hash, if present
+					Handle h = Sexpr::decode_atom(satom, pos);
+					h = add_nocheck(as, h);
+					// There's a trailing colon. Drop it.
+					const std::string& sidcolon = it->key().ToString().substr(2);
+					getKeysMonospace(as, sidcolon.substr(0, sidcolon.size()-1), h);
+				}
+				else if ('n' == pfx[0])
+				{
+					Handle h = Sexpr::decode_atom(it->key().ToString().substr(2));
+					loadSid(as, frame_order, it->value().ToString(), h);
+				}
+				else
+				{
+					const std::string& sid = it->key().ToString().substr(pfx.size());
+					std::string satom;
+					_rfile->Get(rocksdb::ReadOptions(), "a@" + sid + ":", &satom);
+					size_t pos = satom.find('('); // skip over hash, if present
+					Handle h = Sexpr::decode_atom(satom, pos);
+					loadSid(as, frame_order, sid, h);
+				}
+			} catch (const SyntaxException& ex) {
+				logger().warn("RocksStorage: %s\n", ex.get_message());
+				_unknown_type = true;
+			}
+		}
+
+		// Done with this prefix. Single spaces have only one.
+		if (not _multi_space) break;
+
+		// Move on to the next height. Nodes are height zero.
+		size_t height = 1;
+		if ('z' == pfx[0])
+			height = strtoaid(pfx.substr(1, pfx.size()-2)) + 1;
+		start = "z" + aidtostr(height) + "@";
+		it->Seek(start);
+		if (not (it->Valid() and it->key().starts_with(start))) break;
+	}
+	delete it;
+
+	if (_unknown_type)
+	{
+		fprintf(stderr, "Unknown Atom type encountered during load; check logfile!\n");
+		_unknown_type = false;
+	}
+	return "";
+}
+
 /// Load all atoms of type `t`. Not suitable for multi-space loading.
 void RocksStorage::loadTypeMonospace(AtomSpace* as, Type t)
 {
@@ -1316,7 +2163,8 @@ void RocksStorage::loadTypeAllFrames(AtomSpace* as, Type t)
 	if (not _multi_space)
 		throw IOException(TRACE_INFO, "Internal Error!");
 
-	FramePath frame_order = getPath(HandleCast(HandleCast(as)));
+	FramePathPtr ppath = getPath(HandleCast(as));
+	const FramePath& frame_order = *ppath;
 
 	std::string pfx = nameserver().isNode(t) ? "n@(" : "l@(";
 	std::string typ = pfx + nameserver().getTypeName(t);
@@ -1337,6 +2185,320 @@ void RocksStorage::loadType(AtomSpace* as, Type t)
 	loadTypeAllFrames(as, t);
 }
 
+/// Load the Values on the Atom `h` located at `sid`, and place `h`
+/// into `as`. In the multi-space case, the Values are loaded in
+/// frame order, and `h` might end up hidden (deleted) in `as`; in
+/// that case, the undefined handle is returned.
+Handle RocksStorage::loadSid(AtomSpace* as, const FramePath& frame_order,
+                             const std::string& sid, const Handle& h)
+{
+	if (not _multi_space)
+	{
+		Handle ha = add_nocheck(as, h);
+		getKeysMonospace(as, sid, ha);
+		return ha;
+	}
+
+	getKeysMulti(frame_order, sid, h);
+	return as->get_atom(h);
+}
+
+/// Return true if the Atom `sid` can be seen from the top frame of
+/// `frame_order`: it is in one of the frames, and it is not deleted
+/// in the highest one holding it. Always true for files without
+/// frames.
+bool RocksStorage::isVisible(const FramePath& frame_order,
+                             const std::string& sid)
+{
+	if (not _multi_space) return true;
+	if (not inPath(frame_order, sid)) return false;
+
+	std::map<uint64_t, KeyVals> frame_keys;
+	getFrameKeys(sid, frame_order, frame_keys);
+	const KeyVals& kvs = resolveKeys(frame_keys);
+	return 0 < kvs.size() and '-' != kvs[0].first[0];
+}
+
+/// Load a uniform random sample of `n` Atoms of type `t`, together
+/// with their Values. The sample is drawn without replacement; if
+/// there are fewer than `n` such Atoms, all of them are loaded.
+///
+/// Since the aid's are dense integers, the sample is obtained by
+/// drawing random aid's and keeping those that have the right type.
+/// This costs one Get() per draw, and is very fast when the type is
+/// common. If too many draws are rejected (the type is rare, or `n`
+/// is close to the total count), then fall back to a reservoir sample
+/// taken over the `n@(Type` or `l@(Type` range. That is a key scan,
+/// but only the sampled Atoms are decoded and loaded.
+///
+/// With frames, only the Atoms that can be seen from `as` are
+/// sampled; the others are passed over, as if they had the wrong type.
+///
+/// The same seed, on an unchanged DB, gives the same sample.
+HandleSeq RocksStorage::sampleAtoms(AtomSpace* as, Type t,
+                                    size_t n, uint64_t seed)
+{
+	CHECK_OPEN;
+	HandleSeq sample;
+	if (0 == n) return sample;
+
+	FramePathPtr ppath = _multi_space ? getPath(HandleCast(as)) : noPath();
+	const FramePath& frame_order = *ppath;
+
+	const std::string& tname = nameserver().getTypeName(t);
+	std::mt19937_64 rng(seed);
+
+	// The aid's in use run from 1 to _next_aid-1, inclusive.
+	uint64_t maxaid = _next_aid.load() - 1;
+	if (0 < maxaid)
+	{
+		std::uniform_int_distribution<uint64_t> dist(1, maxaid);
+		std::unordered_set<uint64_t> drawn;
+		size_t max_draws = 64 * n;
+		for (size_t i = 0; i < max_draws and sample.size() < n; i++)
+		{
+			uint64_t aid = dist(rng);
+			if (not drawn.insert(aid).second) continue;
+
+			// Not every aid is an Atom: some are frames, and some
+			// Atoms have been deleted.
+			std::string sid = aidtostr(aid);
+			std::string satom;
+			rocksdb::Status s = _rfile->Get(rocksdb::ReadOptions(),
+				"a@" + sid + ":", &satom);
+			if (not s.ok() or not is_of_type(satom, tname)) continue;
+			if (not isVisible(frame_order, sid)) continue;
+
+			try {
+				size_t pos = satom.find('(');
+				Handle h = Sexpr::decode_atom(satom, pos);
+				h = loadSid(as, frame_order, sid, h);
+				if (h) sample.push_back(h);
+			} catch (const SyntaxException& ex) {
+				logger().warn("RocksStorage: %s\n", ex.get_message());
+			}
+		}
+		if (n <= sample.size()) return sample;
+	}
+
+	// Rejection sampling failed to find enough. Discard what we have,
+	// and take a reservoir sample instead, so that the result remains
+	// uniform.
+	sample.clear();
+	std::string pfx = nameserver().isNode(t) ? "n@(" : "l@(";
+	std::string typ = pfx + tname;
+	std::vector<std::pair<std::string, std::string>> reservoir;
+	size_t seen = 0;
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek(typ); it->Valid() and it->key().starts_with(typ); it->Next())
+	{
+		const std::string& satom = it->key().ToString().substr(2);
+		if (not is_of_type(satom, tname)) continue;
+
+		const std::string& sid = it->value().ToString();
+		if (not isVisible(frame_order, sid)) continue;
+
+		seen ++;
+		if (reservoir.size() < n)
+		{
+			reservoir.push_back({satom, sid});
+			continue;
+		}
+		std::uniform_int_distribution<size_t> dist(0, seen-1);
+		size_t slot = dist(rng);
+		if (slot < n)
+			reservoir[slot] = {satom, sid};
+	}
+	delete it;
+
+	for (const auto& pr : reservoir)
+	{
+		try {
+			Handle h = Sexpr::decode_atom(pr.first);
+			h = loadSid(as, frame_order, pr.second, h);
+			if (h) sample.push_back(h);
+		} catch (const SyntaxException& ex) {
+			logger().warn("RocksStorage: %s\n", ex.get_message());
+		}
+	}
+	return sample;
+}
+
+/// Return true if `sval` is a FloatValue, holding a number at `idx`
+/// that is at least `min`.
+static bool at_least(const std::string& sval, size_t idx, double min)
+{
+	FloatValuePtr fv;
+	try
+	{
+		size_t pos = 0;
+		fv = FloatValueCast(Sexpr::decode_value(sval, pos));
+	}
+	catch (...) {}
+	if (nullptr == fv or fv->value().size() <= idx) return false;
+	return min <= fv->value()[idx];
+}
+
+/// Return true if the Value at the key having sid `kid`, on the Atom
+/// `sid`, passes the test in loadTypeWhere(). In the multi-space case,
+/// it is the Value visible in the top frame of `frame_order` that is
+/// tested.
+bool RocksStorage::isWhere(const FramePath& frame_order,
+                           const std::string& sid, const std::string& kid,
+                           size_t idx, double min)
+{
+	if (not _multi_space)
+	{
+		std::string sval;
+		if (not _rfile->Get(rocksdb::ReadOptions(),
+		                    "k@" + sid + ":" + kid, &sval).ok())
+			return false;
+		return at_least(sval, idx, min);
+	}
+
+	if (not inPath(frame_order, sid)) return false;
+
+	std::map<uint64_t, KeyVals> frame_keys;
+	getFrameKeys(sid, frame_order, frame_keys);
+	for (const auto& kv : resolveKeys(frame_keys))
+		if (0 == kv.first.compare(kid))
+			return at_least(kv.second, idx, min);
+	return false;
+}
+
+/// Load all Atoms of type `t` having a FloatValue at `key` with a
+/// number at `idx` that is at least `min`, together with all of their
+/// Values. If `t` is NOTYPE, then Atoms of every type are looked at.
+/// Returns the Atoms that were loaded.
+///
+/// The test is made on the stored Value, before the Atom is decoded;
+/// Atoms that fail it are never placed in the AtomSpace. If there is
+/// a key index (see RocksKeyIndex.cc), only the Atoms having a Value
+/// at `key` are looked at; otherwise, all Atoms of type `t` are.
+HandleSeq RocksStorage::loadTypeWhere(AtomSpace* as, Type t,
+                                      const Handle& key,
+                                      size_t idx, double min)
+{
+	CHECK_OPEN;
+	HandleSeq loaded;
+	const std::string& kid = findAtom(key);
+	if (0 == kid.size()) return loaded;
+
+	FramePathPtr ppath = _multi_space ? getPath(HandleCast(as)) : noPath();
+	const FramePath& frame_order = *ppath;
+
+	std::string tname;
+	if (NOTYPE != t) tname = nameserver().getTypeName(t);
+
+	if (_key_index)
+	{
+		std::vector<std::string> sids;
+		keySids(kid, sids);
+		for (const std::string& sid : sids)
+		{
+			if (not isWhere(frame_order, sid, kid, idx, min)) continue;
+
+			std::string satom;
+			if (not _rfile->Get(rocksdb::ReadOptions(),
+			                    "a@" + sid + ":", &satom).ok())
+				continue;
+			if (NOTYPE != t and not is_of_type(satom, tname)) continue;
+
+			try {
+				size_t pos = satom.find('(');
+				Handle h = Sexpr::decode_atom(satom, pos);
+				h = loadSid(as, frame_order, sid, h);
+				if (h) loaded.push_back(h);
+			} catch (const SyntaxException& ex) {
+				logger().warn("RocksStorage: %s\n", ex.get_message());
+			}
+		}
+		return loaded;
+	}
+
+	std::vector<std::string> pfxs;
+	if (NOTYPE == t)
+		pfxs = {"n@", "l@"};
+	else
+		pfxs = {(nameserver().isNode(t) ? "n@(" : "l@(") + tname};
+
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (const std::string& pfx : pfxs)
+	{
+		for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
+		{
+			const std::string& sid = it->value().ToString();
+			if (not isWhere(frame_order, sid, kid, idx, min)) continue;
+
+			const std::string& satom = it->key().ToString().substr(2);
+			if (NOTYPE != t and not is_of_type(satom, tname)) continue;
+
+			try {
+				Handle h = Sexpr::decode_atom(satom);
+				h = loadSid(as, frame_order, sid, h);
+				if (h) loaded.push_back(h);
+			} catch (const SyntaxException& ex) {
+				logger().warn("RocksStorage: %s\n", ex.get_message());
+			}
+		}
+	}
+	delete it;
+	return loaded;
+}
+
+/// Load all Atoms having a FloatValue at `key` with a number at `idx`
+/// that is at least `min`. See loadTypeWhere().
+HandleSeq RocksStorage::loadAtomSpaceWhere(AtomSpace* as, const Handle& key,
+                                           size_t idx, double min)
+{
+	return loadTypeWhere(as, NOTYPE, key, idx, min);
+}
+
+/// Load up to `limit` Nodes of type `t`, whose names start with
+/// `prefix`, together with their Values. The Nodes are returned in
+/// the order in which they are kept in storage, which is sorted by
+/// the (quoted) name. Only the matching Nodes are read.
+HandleSeq RocksStorage::findNodesByPrefix(AtomSpace* as, Type t,
+                                          const std::string& prefix,
+                                          size_t limit)
+{
+	CHECK_OPEN;
+	HandleSeq found;
+	if (not nameserver().isNode(t))
+		throw IOException(TRACE_INFO, "Not a Node type: %s\n",
+			nameserver().getTypeName(t).c_str());
+
+	FramePathPtr ppath = _multi_space ? getPath(HandleCast(as)) : noPath();
+	const FramePath& frame_order = *ppath;
+
+	// The names are kept quoted, with escapes. Quote the prefix the
+	// same way, and drop the closing quote.
+	std::stringstream ss;
+	ss << std::quoted(prefix);
+	std::string quoted = ss.str();
+	quoted.pop_back();
+	std::string pfx = "n@(" + nameserver().getTypeName(t) + " " + quoted;
+
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek(pfx);
+	     found.size() < limit and it->Valid() and it->key().starts_with(pfx);
+	     it->Next())
+	{
+		const std::string& sid = it->value().ToString();
+		if (_multi_space and not inPath(frame_order, sid)) continue;
+
+		try {
+			Handle h = Sexpr::decode_atom(it->key().ToString().substr(2));
+			h = loadSid(as, frame_order, sid, h);
+			if (h) found.push_back(h);
+		} catch (const SyntaxException& ex) {
+			logger().warn("RocksStorage: %s\n", ex.get_message());
+		}
+	}
+	delete it;
+	return found;
+}
+
 // Store entire contents of the AtomSpace.
 void RocksStorage::storeAtomSpace(const AtomSpace* table)
 {
@@ -1391,20 +2553,65 @@ void RocksStorage::storeAtomSpace(const AtomSpace* table)
 void RocksStorage::kill_data(void)
 {
 	CHECK_OPEN;
-#ifdef HAVE_DELETE_RANGE
-	rocksdb::Slice start, end;
-	_rfile->DeleteRange(rocksdb::WriteOptions(), start, end);
 
-#else
+	// Let go of any frames still being cleaned out.
+	waitForCleaner();
+
+	// Everything goes, with one range delete, running from the empty
+	// key to just past the last key. The files that hold nothing but
+	// deleted keys are then dropped outright, instead of waiting for
+	// compaction to get to them.
+	std::string last;
 	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
-	for (it->Seek(""); it->Valid(); it->Next())
-		_rfile->Delete(rocksdb::WriteOptions(), it->key());
+	it->SeekToLast();
+	if (it->Valid()) last = it->key().ToString();
 	delete it;
-#endif
+	if (0 < last.size())
+	{
+		last.push_back('\0');
+		_rfile->DeleteRange(rocksdb::WriteOptions(), "", last);
+		rocksdb::DeleteFilesInRange(_rfile, _rfile->DefaultColumnFamily(),
+			nullptr, nullptr);
+	}
+
+	// Drop all of the frames kept in column families.
+	std::vector<std::string> fidcs;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_family);
+		for (const auto& fpr : _families)
+			if (0 == fpr.first.compare(0, 6, "frame-"))
+				fidcs.push_back(fpr.first.substr(6) + ":");
+	}
+	for (const std::string& fidc : fidcs)
+		dropFamily(fidc);
+
+	// The declarations are gone, too.
+	{
+		std::lock_guard<std::mutex> lck(_mtx_marginal);
+		_marginals.clear();
+	}
+	{
+		std::lock_guard<std::mutex> lck(_mtx_order);
+		_orders.clear();
+	}
+
+	// Forget the frames and views.
+	_multi_space = false;
+	{
+		std::lock_guard<std::mutex> flck(_mtx_frame);
+		resetFrames();
+	}
+	_frames_loaded = false;
+	clearFilters();
+	{
+		std::lock_guard<std::shared_mutex> lck(_mtx_view);
+		_views.clear();
+	}
 
-	// Reset.
+	// Reset. The DB version and layout went with everything else.
 	_next_aid = 1;
 	write_aid();
+	write_markers();
 }
 
 /// Dump database contents to stdout.
@@ -1438,26 +2645,40 @@ void RocksStorage::checkdb()
 {
 	CHECK_OPEN;
 
+	// Deleted frames must be completely gone, first.
+	waitForCleaner();
+
 	bool db_ok = true;
 
 	// Look for orphaned Values -- Values not attached to any Atom.
 	// These are in the form of "k@sid:" which have no matching "a@sid:"
 	// Note the use of the colon to terminate the sid!
+	// Look in the frame column families, too, if there are any.
+	std::vector<rocksdb::ColumnFamilyHandle*> cfhs;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_family);
+		for (const auto& fpr : _families)
+			cfhs.push_back(fpr.second);
+	}
+
 	std::string pfx = "k@";
 	size_t cnt = 0;
-	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
-	for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
+	for (auto cfh : cfhs)
 	{
-		std::string vkey = it->key().ToString();
-		vkey[0] = 'a';
-		vkey.resize(vkey.find(':') + 1);
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+		for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
+		{
+			std::string vkey = it->key().ToString();
+			vkey[0] = 'a';
+			vkey.resize(vkey.find(':') + 1);
 
-		std::string satom;
-		rocksdb::Status s = _rfile->Get(rocksdb::ReadOptions(), vkey,  &satom);
-		if (not s.ok())
-			cnt++;
+			std::string satom;
+			rocksdb::Status s = _rfile->Get(rocksdb::ReadOptions(), vkey,  &satom);
+			if (not s.ok())
+				cnt++;
+		}
+		delete it;
 	}
-	delete it;
 
 	if (cnt)
 	{
@@ -1474,6 +2695,8 @@ void RocksStorage::checkdb()
 
 void RocksStorage::scrubdb()
 {
+	CHECK_OPEN;
+	waitForCleaner();
 	scrubFrames();
 }
 
@@ -0,0 +1,275 @@
+/*
+ * RocksKeyIndex.cc
+ * Find the Atoms that have a Value at a given key.
+ *
+ * Copyright (c) 2022 Linas Vepstas <linas@linas.org>
+ *
+ * LICENSE:
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "rocksdb/write_batch.h"
+
+#include <opencog/atomspace/AtomSpace.h>
+
+#include "RocksStorage.h"
+#include "RocksUtils.h"
+
+using namespace opencog;
+
+// ======================================================================
+// The Values are kept in `k@sid:kid` records, sorted by Atom. Finding
+// all of the Atoms having a Value at some key means scanning all of
+// them. With the `key-index` URI option, a reverse index is kept, as
+// `K@kid:sid` records, so that these can be found directly.
+//
+// With frames, there is one index record, no matter how many frames
+// hold a Value for the Atom; which frames can see the Value is worked
+// out when the Atoms are loaded. Thus, the index says only that some
+// frame might have the Value: it is not updated when frames are
+// deleted or squashed. Stale records are skipped when loading.
+
+/// Add the `k@` record `skid` to the index, when `batch` is written.
+/// The `skid` can be in any of the `k@` formats, with or without the
+/// fid.
+void RocksStorage::indexKey(rocksdb::WriteBatch& batch,
+                            const std::string& skid)
+{
+	const std::string& sid = skid.substr(2, skid.find(':') - 2);
+	const std::string& kid = skid.substr(skid.rfind(':') + 1);
+	batch.Put("K@" + kid + ":" + sid, "");
+}
+
+/// Remove the `k@` record `skid` from the index, when `batch` is
+/// written.
+void RocksStorage::unindexKey(rocksdb::WriteBatch& batch,
+                              const std::string& skid)
+{
+	const std::string& sid = skid.substr(2, skid.find(':') - 2);
+	const std::string& kid = skid.substr(skid.rfind(':') + 1);
+	batch.Delete("K@" + kid + ":" + sid);
+}
+
+/// Build the index from scratch. This is needed only the first time
+/// that the `key-index` option is used on a file.
+void RocksStorage::buildKeyIndex(void)
+{
+	_rfile->DeleteRange(rocksdb::WriteOptions(), "K@", prefix_end("K@"));
+
+	std::vector<rocksdb::ColumnFamilyHandle*> cfhs;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_family);
+		for (const auto& fpr : _families)
+			cfhs.push_back(fpr.second);
+	}
+	rocksdb::WriteBatch batch;
+	for (auto cfh : cfhs)
+	{
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+		for (it->Seek("k@"); it->Valid() and it->key().starts_with("k@"); it->Next())
+		{
+			const std::string& skid = it->key().ToString();
+			char c = skid[skid.rfind(':') + 1];
+			if ('+' == c or '-' == c) continue;
+
+			indexKey(batch, skid);
+			if (CLEAN_BATCH_SIZE < batch.Count())
+			{
+				_rfile->Write(rocksdb::WriteOptions(), &batch);
+				batch.Clear();
+			}
+		}
+		delete it;
+	}
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
+}
+
+/// Get the sids of all Atoms that might have a Value at `kid`. If
+/// there is no index (the file is open read-only, and the index was
+/// never built) then do it the hard way.
+void RocksStorage::keySids(const std::string& kid,
+                           std::vector<std::string>& sids)
+{
+	if (_key_index)
+	{
+		std::string pfx = "K@" + kid + ":";
+		size_t off = pfx.size();
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+		for (it->Seek(pfx); it->Valid() and it->key().starts_with(pfx); it->Next())
+			sids.push_back(it->key().ToString().substr(off));
+		delete it;
+		return;
+	}
+
+	std::vector<rocksdb::ColumnFamilyHandle*> cfhs;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_family);
+		for (const auto& fpr : _families)
+			cfhs.push_back(fpr.second);
+	}
+
+	std::string ckid = ":" + kid;
+	std::set<std::string> found;
+	for (auto cfh : cfhs)
+	{
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+		for (it->Seek("k@"); it->Valid() and it->key().starts_with("k@"); it->Next())
+		{
+			const std::string& skid = it->key().ToString();
+			if (skid.size() < ckid.size() or
+			    skid.compare(skid.size() - ckid.size(), ckid.size(), ckid))
+				continue;
+			found.insert(skid.substr(2, skid.find(':') - 2));
+		}
+		delete it;
+	}
+	sids.insert(sids.end(), found.begin(), found.end());
+}
+
+// ======================================================================
+// User API
+
+/// Load all of the Atoms that have a Value at `key`, together with
+/// all of their Values, into `as`. In the multi-space case, only the
+/// Atoms for which the Value is visible from `as` are loaded. Returns
+/// the Atoms that were loaded.
+HandleSeq RocksStorage::loadByKey(AtomSpace* as, const Handle& key)
+{
+	CHECK_OPEN;
+	HandleSeq loaded;
+	const std::string& kid = findAtom(key);
+	if (0 == kid.size()) return loaded;
+
+	std::vector<std::string> sids;
+	keySids(kid, sids);
+
+	FramePathPtr ppath = _multi_space ? getPath(HandleCast(as)) : noPath();
+	const FramePath& frame_order = *ppath;
+
+	for (const std::string& sid : sids)
+	{
+		if (not _multi_space)
+		{
+			std::string dummy;
+			if (not _rfile->Get(rocksdb::ReadOptions(),
+			                    "k@" + sid + ":" + kid, &dummy).ok())
+			{
+				if (_key_index and not _read_only)
+					_rfile->Delete(rocksdb::WriteOptions(), "K@" + kid + ":" + sid);
+				continue;
+			}
+		}
+		else
+		{
+			if (not inPath(frame_order, sid)) continue;
+
+			std::map<uint64_t, KeyVals> frame_keys;
+			getFrameKeys(sid, frame_order, frame_keys);
+			bool visible = false;
+			for (const auto& kv : resolveKeys(frame_keys))
+				if (0 == kv.first.compare(kid)) { visible = true; break; }
+			if (not visible) continue;
+		}
+
+		// The type might be unknown; getAtom() has warned about it.
+		Handle h = getAtom(sid);
+		if (nullptr == h) { _unknown_type = true; continue; }
+
+		h = loadSid(as, frame_order, sid, h);
+		if (h) loaded.push_back(h);
+	}
+	return loaded;
+}
+
+/// Delete the Values at `key` from every Atom in storage, in every
+/// frame. The Atoms themselves are kept, as are the Values at `key`
+/// in any AtomSpace.
+void RocksStorage::dropKey(const Handle& key)
+{
+	CHECK_OPEN;
+	const std::string& kid = findAtom(key);
+	if (0 == kid.size()) return;
+
+	std::vector<std::string> sids;
+	keySids(kid, sids);
+
+	if (not _multi_space)
+	{
+		std::shared_lock<std::shared_mutex> dlck(_mtx_declare);
+		for (const std::string& sid : sids)
+		{
+			std::string skid = "k@" + sid + ":" + kid;
+			std::lock_guard<std::mutex> slck(sidLock(sid));
+			std::string sval;
+			if (not _rfile->Get(rocksdb::ReadOptions(), skid, &sval).ok())
+				continue;
+
+			std::string satom;
+			_rfile->Get(rocksdb::ReadOptions(), "a@" + sid + ":", &satom);
+			if (0 < satom.size()) removeMarginal(satom, kid, sval);
+
+			rocksdb::WriteBatch batch;
+			removeOrdered(batch, sid, kid, sval);
+			batch.Delete(skid);
+			addCount(batch, "C@k@", -1);
+			_rfile->Write(rocksdb::WriteOptions(), &batch);
+		}
+	}
+	else
+	{
+		// Every frame there is.
+		FramePath all;
+		auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+		for (it->Seek("d@"); it->Valid() and it->key().starts_with("d@"); it->Next())
+			all.emplace(strtoaid(it->key().ToString().substr(2)), Handle::UNDEFINED);
+		delete it;
+
+		for (const std::string& sid : sids)
+		{
+			std::map<uint64_t, KeyVals> frame_keys;
+			getFrameKeys(sid, all, frame_keys);
+			for (const auto& fk : frame_keys)
+			{
+				bool have = false;
+				for (const auto& kv : fk.second)
+					if (0 == kv.first.compare(kid)) { have = true; break; }
+				if (not have) continue;
+
+				// If that was the only Value, the Atom is still in
+				// the frame; mark it as such.
+				std::string fidc = aidtostr(fk.first) + ":";
+				std::string skid = keyPrefix(sid, fidc);
+				auto cfh = frameFamily(fidc);
+				if (1 == fk.second.size())
+					_rfile->Put(rocksdb::WriteOptions(), cfh, skid + "+1", "");
+				_rfile->Delete(rocksdb::WriteOptions(), cfh, skid + kid);
+				addCount("C@k@", -1);
+				addCount("c@" + fidc + "v", -1);
+				updateViews(fidc, sid);
+			}
+		}
+	}
+
+	if (_key_index)
+	{
+		std::string pfx = "K@" + kid + ":";
+		_rfile->DeleteRange(rocksdb::WriteOptions(), pfx, prefix_end(pfx));
+	}
+}
+
+// ======================== THE END ======================
@@ -0,0 +1,232 @@
+/*
+ * RocksMarginal.cc
+ * Sums of Values over incoming sets, kept up to date as Values change.
+ *
+ * Copyright (c) 2022 Linas Vepstas <linas@linas.org>
+ *
+ * LICENSE:
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/value/FloatValue.h>
+#include <opencog/persist/sexpr/Sexpr.h>
+
+#include "RocksStorage.h"
+#include "RocksUtils.h"
+
+using namespace opencog;
+
+// ======================================================================
+// A marginal is the sum of the Values at some key, over all of the
+// Links of some type that an Atom appears in, at some position in
+// the outgoing set. For example, the marginal of (Concept "a") for
+// EdgeLinks, key K and position 1 is the sum of the Values at K on
+// all (Edge (Predicate ...) (Concept "a") ...) Links.
+//
+// Computing these requires fetching and decoding the entire incoming
+// set. Instead, the marginals that are wanted can be declared ahead
+// of time. After that, they are updated with the difference between
+// the old and new Values, every time a Value at that key is stored
+// on a Link of that type. The updates are merges; see RocksCount.cc.
+// Only FloatValues are added up; all other Values count as zero.
+//
+// The declarations are kept in `m@TYPE:kid` records, and the sums in
+// `M@sid:TYPE:kid:pos` records, where `kid` is the sid of the key.
+//
+// Marginals are kept only for files without frames. It is not clear
+// what the sum over an incoming set should be, when the Values on
+// the Links depend on which frame they are seen from.
+
+/// Return the Value as a vector of numbers. Anything that is not a
+/// FloatValue is empty.
+static std::vector<double> floats(const ValuePtr& vp)
+{
+	FloatValuePtr fv = FloatValueCast(vp);
+	if (nullptr == fv) return std::vector<double>();
+	return fv->value();
+}
+
+/// Load the marginal declarations.
+void RocksStorage::loadMarginals(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx_marginal);
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("m@"); it->Valid() and it->key().starts_with("m@"); it->Next())
+		_marginals.insert(it->key().ToString().substr(2));
+	delete it;
+}
+
+/// Return the marginal id `TYPE:kid` for the Value of `h` at the key
+/// having sid `kid`, or the empty string, if no such marginal has
+/// been declared.
+std::string RocksStorage::marginalId(const Handle& h, const std::string& kid)
+{
+	if (not h->is_link()) return "";
+
+	std::lock_guard<std::mutex> lck(_mtx_marginal);
+	if (_marginals.empty()) return "";
+
+	std::string mid = nameserver().getTypeName(h->get_type()) + ":" + kid;
+	if (_marginals.end() == _marginals.find(mid)) return "";
+	return mid;
+}
+
+/// Add `delta` to the marginal `mid` of each Atom in the outgoing
+/// set of `h`.
+void RocksStorage::addMarginals(const Handle& h, const std::string& mid,
+                                const std::vector<double>& delta)
+{
+	bool zero = true;
+	for (double d : delta)
+		if (0.0 != d) { zero = false; break; }
+	if (zero) return;
+
+	const std::string& sdelta = Sexpr::encode_value(createFloatValue(delta));
+	const HandleSeq& oset = h->getOutgoingSet();
+	for (size_t pos = 0; pos < oset.size(); pos++)
+	{
+		const std::string& osid = findAtom(oset[pos]);
+		_rfile->Merge(rocksdb::WriteOptions(),
+			"M@" + osid + ":" + mid + ":" + std::to_string(pos), sdelta);
+	}
+}
+
+/// Store `vp` as the Value of `h` at `skid`, and add the difference
+/// between it and the old Value to the marginal `mid`.
+void RocksStorage::storeMarginal(const std::string& mid, const Handle& h,
+                                 const std::string& skid, const ValuePtr& vp)
+{
+	// The old Value must not change before the new one is written.
+	std::lock_guard<std::mutex> lck(_mtx_store_marginal);
+
+	std::vector<double> old;
+	std::string sval;
+	if (_rfile->Get(rocksdb::ReadOptions(), skid, &sval).ok())
+	{
+		size_t pos = 0;
+		old = floats(Sexpr::decode_value(sval, pos));
+	}
+
+	std::vector<double> delta = floats(vp);
+	if (delta.size() < old.size()) delta.resize(old.size(), 0.0);
+	for (size_t i = 0; i < old.size(); i++) delta[i] -= old[i];
+
+	storeValue(_rfile->DefaultColumnFamily(), "", skid, vp);
+	addMarginals(h, mid, delta);
+}
+
+/// The Link at `satom` (possibly with a hash in front of it) is being
+/// removed. Subtract the Value `sval`, at the key having sid `kid`,
+/// from its marginals, if any.
+void RocksStorage::removeMarginal(const std::string& satom,
+                                  const std::string& kid,
+                                  const std::string& sval)
+{
+	size_t paren = satom.find('(');
+	size_t end = satom.find_first_of(" )", paren);
+	std::string mid = satom.substr(paren+1, end-paren-1) + ":" + kid;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_marginal);
+		if (_marginals.end() == _marginals.find(mid)) return;
+	}
+
+	size_t pos = 0;
+	std::vector<double> delta = floats(Sexpr::decode_value(sval, pos));
+	for (double& d : delta) d = -d;
+
+	pos = paren;
+	addMarginals(Sexpr::decode_atom(satom, pos), mid, delta);
+}
+
+// ======================================================================
+// User API
+
+/// Declare that the sum of the Values at `key`, over all Links of
+/// type `t` in the incoming set, should be kept for each Atom. The
+/// sums are computed now, for the Links that are already stored.
+void RocksStorage::declareMarginal(Type t, const Handle& key)
+{
+	CHECK_OPEN;
+	if (_multi_space)
+		throw IOException(TRACE_INFO,
+			"Marginals are not supported for files holding frames!");
+	if (not nameserver().isLink(t))
+		throw IOException(TRACE_INFO, "Marginals are kept only for Links!");
+
+	const std::string& tname = nameserver().getTypeName(t);
+	const std::string& kid = writeAtom(key);
+	std::string mid = tname + ":" + kid;
+
+	// Hold off stores and deletes, until the existing Values have
+	// been summed. Those that start after this will wait for the lock,
+	// and then update the marginal.
+	std::lock_guard<std::shared_mutex> dlck(_mtx_declare);
+	{
+		std::lock_guard<std::mutex> lck(_mtx_marginal);
+		if (not _marginals.insert(mid).second) return;
+	}
+
+	std::string lpfx = "l@(" + tname + " ";
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek(lpfx); it->Valid() and it->key().starts_with(lpfx); it->Next())
+	{
+		std::string sval;
+		const std::string& sid = it->value().ToString();
+		if (not _rfile->Get(rocksdb::ReadOptions(),
+		                    "k@" + sid + ":" + kid, &sval).ok())
+			continue;
+
+		size_t pos = 0;
+		std::vector<double> vals = floats(Sexpr::decode_value(sval, pos));
+		addMarginals(getAtom(sid), mid, vals);
+	}
+	delete it;
+
+	_rfile->Put(rocksdb::WriteOptions(), "m@" + mid, "");
+}
+
+/// Return the sum of the Values at `key`, over all Links of type `t`
+/// that hold `h` at position `pos` of their outgoing set. The marginal
+/// must have been declared with declareMarginal().
+ValuePtr RocksStorage::getMarginal(const Handle& h, Type t,
+                                   const Handle& key, size_t pos)
+{
+	CHECK_OPEN;
+	const std::string& kid = findAtom(key);
+	std::string mid = nameserver().getTypeName(t) + ":" + kid;
+	{
+		std::lock_guard<std::mutex> lck(_mtx_marginal);
+		if (0 == kid.size() or _marginals.end() == _marginals.find(mid))
+			throw IOException(TRACE_INFO,
+				"No marginal was declared for %s on %s\n",
+				key->to_short_string().c_str(),
+				nameserver().getTypeName(t).c_str());
+	}
+
+	std::string sval;
+	const std::string& sid = findAtom(h);
+	if (0 == sid.size() or not _rfile->Get(rocksdb::ReadOptions(),
+	        "M@" + sid + ":" + mid + ":" + std::to_string(pos), &sval).ok())
+		return createFloatValue(std::vector<double>());
+
+	size_t spos = 0;
+	return Sexpr::decode_value(sval, spos);
+}
+
+// ======================== THE END ======================
@@ -0,0 +1,238 @@
+/*
+ * RocksOrder.cc
+ * Atoms sorted by the number in one of their Values.
+ *
+ * Copyright (c) 2022 Linas Vepstas <linas@linas.org>
+ *
+ * LICENSE:
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cinttypes>
+#include <cstring>
+
+#include "rocksdb/write_batch.h"
+
+#include <opencog/atoms/value/FloatValue.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/persist/sexpr/Sexpr.h>
+
+#include "RocksStorage.h"
+#include "RocksUtils.h"
+
+using namespace opencog;
+
+// ======================================================================
+// Finding the Atoms with the largest counts requires loading all of
+// them, and sorting. Instead, an index can be declared, for one of the
+// numbers in the FloatValues at some key. For every Atom having such
+// a Value, there is then an `X@kid:idx:num:sid` record, where `num`
+// is the number, encoded so that the records sort in numeric order.
+// Finding the largest is then a short scan, backwards from the end.
+//
+// The declarations are kept in `x@kid:idx` records.
+//
+// Like the marginals (see RocksMarginal.cc), these are kept only for
+// files without frames, since the number depends on the frame it is
+// seen from.
+
+/// Encode `num` as sixteen hex digits, such that the strings sort the
+/// same way as the numbers do. This is the usual trick: flip the sign
+/// bit of positive numbers, and all of the bits of negative numbers.
+static std::string encode_order(double num)
+{
+	uint64_t bits;
+	memcpy(&bits, &num, sizeof(bits));
+	if (bits & 0x8000000000000000ULL) bits = ~bits;
+	else bits |= 0x8000000000000000ULL;
+
+	char buf[17];
+	snprintf(buf, sizeof(buf), "%016" PRIx64, bits);
+	return buf;
+}
+
+/// Return the index record for the number at `idx` in the Value
+/// `sval`, or the empty string, if there is no such number.
+static std::string order_key(const std::string& kid, size_t idx,
+                             const std::string& sval,
+                             const std::string& sid)
+{
+	FloatValuePtr fv;
+	try
+	{
+		size_t pos = 0;
+		fv = FloatValueCast(Sexpr::decode_value(sval, pos));
+	}
+	catch (...) {}
+	if (nullptr == fv or fv->value().size() <= idx) return "";
+
+	return "X@" + kid + ":" + std::to_string(idx) + ":" +
+		encode_order(fv->value()[idx]) + ":" + sid;
+}
+
+/// Load the index declarations.
+void RocksStorage::loadOrders(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx_order);
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("x@"); it->Valid() and it->key().starts_with("x@"); it->Next())
+	{
+		const std::string& decl = it->key().ToString();
+		size_t colon = decl.find(':');
+		_orders[decl.substr(2, colon-2)].insert(
+			std::stoul(decl.substr(colon+1)));
+	}
+	delete it;
+}
+
+/// Return the indexes declared for the key having sid `kid`.
+std::set<size_t> RocksStorage::orderIndexes(const std::string& kid)
+{
+	std::lock_guard<std::mutex> lck(_mtx_order);
+	if (_orders.empty()) return std::set<size_t>();
+	auto oit = _orders.find(kid);
+	if (_orders.end() == oit) return std::set<size_t>();
+	return oit->second;
+}
+
+/// Write the Value `sval` to the record `skid`, and update the
+/// indexes `idxs`. The old Value is read, and the new one written
+/// together with its index records, under the lock for the Atom.
+void RocksStorage::storeOrdered(const std::string& skid,
+                                const std::string& sval,
+                                const std::set<size_t>& idxs)
+{
+	const std::string& sid = skid.substr(2, skid.find(':') - 2);
+	const std::string& kid = skid.substr(skid.rfind(':') + 1);
+
+	std::lock_guard<std::mutex> slck(sidLock(sid));
+	std::string sold;
+	bool fresh = not _rfile->Get(rocksdb::ReadOptions(), skid, &sold).ok();
+
+	rocksdb::WriteBatch batch;
+	batch.Put(skid, sval);
+	if (fresh)
+	{
+		addCount(batch, "C@k@", 1);
+		if (_key_index) indexKey(batch, skid);
+	}
+
+	for (size_t idx : idxs)
+	{
+		const std::string& okey = order_key(kid, idx, sold, sid);
+		const std::string& nkey = order_key(kid, idx, sval, sid);
+		if (okey == nkey) continue;
+		if (0 < okey.size()) batch.Delete(okey);
+		if (0 < nkey.size()) batch.Put(nkey, "");
+	}
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
+}
+
+/// The Value `sval` at the key having sid `kid`, on the Atom `sid`,
+/// is being deleted. Remove it from the indexes, when `batch` is
+/// written.
+void RocksStorage::removeOrdered(rocksdb::WriteBatch& batch,
+                                 const std::string& sid,
+                                 const std::string& kid,
+                                 const std::string& sval)
+{
+	for (size_t idx : orderIndexes(kid))
+	{
+		const std::string& okey = order_key(kid, idx, sval, sid);
+		if (0 < okey.size()) batch.Delete(okey);
+	}
+}
+
+// ======================================================================
+// User API
+
+/// Declare that the Atoms having a FloatValue at `key` should be kept
+/// sorted by the number at `idx` in that FloatValue. The Values that
+/// are already stored are sorted now.
+void RocksStorage::declareOrder(const Handle& key, size_t idx)
+{
+	CHECK_OPEN;
+	if (_multi_space)
+		throw IOException(TRACE_INFO,
+			"Ordered indexes are not supported for files holding frames!");
+
+	const std::string& kid = writeAtom(key);
+
+	// Hold off stores and deletes, until the existing Values are
+	// indexed. Those that start after this will wait for the lock,
+	// and then update the index.
+	std::lock_guard<std::shared_mutex> dlck(_mtx_declare);
+	{
+		std::lock_guard<std::mutex> lck(_mtx_order);
+		if (not _orders[kid].insert(idx).second) return;
+	}
+
+	std::vector<std::string> sids;
+	keySids(kid, sids);
+	for (const std::string& sid : sids)
+	{
+		std::string sval;
+		if (not _rfile->Get(rocksdb::ReadOptions(),
+		                    "k@" + sid + ":" + kid, &sval).ok())
+			continue;
+		const std::string& okey = order_key(kid, idx, sval, sid);
+		if (0 < okey.size())
+			_rfile->Put(rocksdb::WriteOptions(), okey, "");
+	}
+
+	_rfile->Put(rocksdb::WriteOptions(),
+		"x@" + kid + ":" + std::to_string(idx), "");
+}
+
+/// Load the `n` Atoms having the largest numbers at `idx` in their
+/// Values at `key`, together with all of their Values. The index must
+/// have been declared with declareOrder(). Returns the Atoms, largest
+/// first.
+HandleSeq RocksStorage::loadTopK(AtomSpace* as, const Handle& key,
+                                 size_t idx, size_t n)
+{
+	CHECK_OPEN;
+	const std::string& kid = findAtom(key);
+	if (0 == kid.size() or 0 == orderIndexes(kid).count(idx))
+		throw IOException(TRACE_INFO,
+			"No ordered index was declared for %s at %zu\n",
+			key->to_short_string().c_str(), idx);
+
+	HandleSeq top;
+	FramePath frame_order;
+	std::string pfx = "X@" + kid + ":" + std::to_string(idx) + ":";
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->SeekForPrev(prefix_end(pfx));
+	     top.size() < n and it->Valid() and it->key().starts_with(pfx);
+	     it->Prev())
+	{
+		const std::string& okey = it->key().ToString();
+		const std::string& sid = okey.substr(okey.rfind(':') + 1);
+
+		// The type might be unknown; getAtom() has warned about it.
+		Handle h = getAtom(sid);
+		if (nullptr == h) { _unknown_type = true; continue; }
+
+		h = loadSid(as, frame_order, sid, h);
+		if (h) top.push_back(h);
+	}
+	delete it;
+	return top;
+}
+
+// ======================== THE END ======================
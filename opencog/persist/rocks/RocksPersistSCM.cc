@@ -25,6 +25,7 @@
 
 #include <libguile.h>
 
+#include <opencog/atoms/value/LinkValue.h>
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/persist/api/StorageNode.h>
 #include <opencog/persist/rocks-types/atom_types.h>
@@ -72,6 +73,26 @@ void RocksPersistSCM::init(void)
     define_scheme_primitive("cog-rocks-print", &RocksPersistSCM::do_print, this, "persist-rocks");
     define_scheme_primitive("cog-rocks-check", &RocksPersistSCM::do_check, this, "persist-rocks");
     define_scheme_primitive("cog-rocks-scrub", &RocksPersistSCM::do_scrub, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-sample", &RocksPersistSCM::do_sample, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-load-chunk", &RocksPersistSCM::do_load_chunk, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-materialize-view", &RocksPersistSCM::do_materialize_view, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-drop-view", &RocksPersistSCM::do_drop_view, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-squash", &RocksPersistSCM::do_squash, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-diff", &RocksPersistSCM::do_diff, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-count", &RocksPersistSCM::do_count, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-incoming-size", &RocksPersistSCM::do_incoming_size, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-incoming-size-by-type", &RocksPersistSCM::do_incoming_size_by_type, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-declare-marginal", &RocksPersistSCM::do_declare_marginal, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-marginal", &RocksPersistSCM::do_marginal, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-load-by-key", &RocksPersistSCM::do_load_by_key, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-drop-key", &RocksPersistSCM::do_drop_key, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-declare-order", &RocksPersistSCM::do_declare_order, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-load-top", &RocksPersistSCM::do_load_top, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-load-where", &RocksPersistSCM::do_load_where, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-load-type-where", &RocksPersistSCM::do_load_type_where, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-nodes-by-prefix", &RocksPersistSCM::do_nodes_by_prefix, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-delete-type", &RocksPersistSCM::do_delete_type, this, "persist-rocks");
+    define_scheme_primitive("cog-rocks-remove-atoms", &RocksPersistSCM::do_remove_atoms, this, "persist-rocks");
 }
 
 RocksPersistSCM::~RocksPersistSCM()
@@ -144,7 +165,6 @@ void RocksPersistSCM::do_get(const std::string& prefix)
 	if (nullptr == snp) { \
 		throw RuntimeException(TRACE_INFO, \
 			FUN ": Error: Not a RocksStorageNode!"); \
-		return; \
 	}
 
 void RocksPersistSCM::do_stats(const Handle& h)
@@ -177,6 +197,164 @@ void RocksPersistSCM::do_scrub(const Handle& h)
 	snp->scrubdb();
 }
 
+HandleSeq RocksPersistSCM::do_sample(const Handle& h, Type t,
+                                     size_t n, size_t seed)
+{
+	GET_SNP("cog-rocks-sample")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-sample");
+	return snp->sampleAtoms(as.get(), t, n, seed);
+}
+
+std::string RocksPersistSCM::do_load_chunk(const Handle& h,
+                                           const std::string& cursor,
+                                           size_t budget)
+{
+	GET_SNP("cog-rocks-load-chunk")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-load-chunk");
+	return snp->loadAtomSpaceChunk(as.get(), cursor, budget);
+}
+
+void RocksPersistSCM::do_materialize_view(const Handle& h)
+{
+	GET_SNP("cog-rocks-materialize-view")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-materialize-view");
+	snp->materializeView(as.get());
+}
+
+void RocksPersistSCM::do_drop_view(const Handle& h)
+{
+	GET_SNP("cog-rocks-drop-view")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-drop-view");
+	snp->dropView(as.get());
+}
+
+void RocksPersistSCM::do_squash(const Handle& h, size_t depth)
+{
+	GET_SNP("cog-rocks-squash")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-squash");
+	snp->squashFrames(as.get(), depth);
+}
+
+ValuePtr RocksPersistSCM::do_diff(const Handle& h,
+                                  const Handle& ha, const Handle& hb)
+{
+	GET_SNP("cog-rocks-diff")
+	AtomSpacePtr asa = AtomSpaceCast(ha);
+	AtomSpacePtr asb = AtomSpaceCast(hb);
+	if (nullptr == asa or nullptr == asb)
+		throw RuntimeException(TRACE_INFO,
+			"cog-rocks-diff: Error: Expecting two AtomSpaces!");
+
+	HandleSeq added, removed, changed;
+	snp->diffFrames(asa.get(), asb.get(), added, removed, changed);
+	return createLinkValue(ValueSeq({
+		createLinkValue(added),
+		createLinkValue(removed),
+		createLinkValue(changed)}));
+}
+
+size_t RocksPersistSCM::do_count(const Handle& h, Type t)
+{
+	GET_SNP("cog-rocks-count")
+	return snp->countType(t);
+}
+
+size_t RocksPersistSCM::do_incoming_size(const Handle& h, const Handle& atom)
+{
+	GET_SNP("cog-rocks-incoming-size")
+	return snp->getIncomingSize(atom);
+}
+
+size_t RocksPersistSCM::do_incoming_size_by_type(const Handle& h,
+                                                 const Handle& atom, Type t)
+{
+	GET_SNP("cog-rocks-incoming-size-by-type")
+	return snp->getIncomingSize(atom, t);
+}
+
+void RocksPersistSCM::do_declare_marginal(const Handle& h, Type t,
+                                          const Handle& key)
+{
+	GET_SNP("cog-rocks-declare-marginal")
+	snp->declareMarginal(t, key);
+}
+
+ValuePtr RocksPersistSCM::do_marginal(const Handle& h, const Handle& atom,
+                                      Type t, const Handle& key, size_t pos)
+{
+	GET_SNP("cog-rocks-marginal")
+	return snp->getMarginal(atom, t, key, pos);
+}
+
+HandleSeq RocksPersistSCM::do_load_by_key(const Handle& h, const Handle& key)
+{
+	GET_SNP("cog-rocks-load-by-key")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-load-by-key");
+	return snp->loadByKey(as.get(), key);
+}
+
+void RocksPersistSCM::do_drop_key(const Handle& h, const Handle& key)
+{
+	GET_SNP("cog-rocks-drop-key")
+	snp->dropKey(key);
+}
+
+void RocksPersistSCM::do_declare_order(const Handle& h, const Handle& key,
+                                       size_t idx)
+{
+	GET_SNP("cog-rocks-declare-order")
+	snp->declareOrder(key, idx);
+}
+
+HandleSeq RocksPersistSCM::do_load_top(const Handle& h, const Handle& key,
+                                       size_t idx, size_t n)
+{
+	GET_SNP("cog-rocks-load-top")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-load-top");
+	return snp->loadTopK(as.get(), key, idx, n);
+}
+
+HandleSeq RocksPersistSCM::do_load_where(const Handle& h, const Handle& key,
+                                         size_t idx, double min)
+{
+	GET_SNP("cog-rocks-load-where")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-load-where");
+	return snp->loadAtomSpaceWhere(as.get(), key, idx, min);
+}
+
+HandleSeq RocksPersistSCM::do_load_type_where(const Handle& h, Type t,
+                                              const Handle& key,
+                                              size_t idx, double min)
+{
+	GET_SNP("cog-rocks-load-type-where")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-load-type-where");
+	return snp->loadTypeWhere(as.get(), t, key, idx, min);
+}
+
+HandleSeq RocksPersistSCM::do_nodes_by_prefix(const Handle& h, Type t,
+                                              const std::string& prefix,
+                                              size_t limit)
+{
+	GET_SNP("cog-rocks-nodes-by-prefix")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-nodes-by-prefix");
+	return snp->findNodesByPrefix(as.get(), t, prefix, limit);
+}
+
+size_t RocksPersistSCM::do_delete_type(const Handle& h, Type t,
+                                       bool recursive)
+{
+	GET_SNP("cog-rocks-delete-type")
+	return snp->deleteType(t, recursive);
+}
+
+void RocksPersistSCM::do_remove_atoms(const Handle& h, const HandleSeq& hs,
+                                      bool recursive)
+{
+	GET_SNP("cog-rocks-remove-atoms")
+	AtomSpacePtr as = SchemeSmob::ss_get_env_as("cog-rocks-remove-atoms");
+	snp->removeAtoms(as.get(), hs, recursive);
+}
+
 void opencog_persist_rocks_init(void)
 {
 	static RocksPersistSCM patty(nullptr);
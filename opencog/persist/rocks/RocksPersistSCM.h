@@ -63,6 +63,30 @@ public:
 	void do_print(const Handle&, const std::string&);
 	void do_check(const Handle&);
 	void do_scrub(const Handle&);
+
+	HandleSeq do_sample(const Handle&, Type, size_t, size_t);
+	std::string do_load_chunk(const Handle&, const std::string&, size_t);
+	void do_materialize_view(const Handle&);
+	void do_drop_view(const Handle&);
+	void do_squash(const Handle&, size_t);
+	ValuePtr do_diff(const Handle&, const Handle&, const Handle&);
+	size_t do_count(const Handle&, Type);
+	size_t do_incoming_size(const Handle&, const Handle&);
+	size_t do_incoming_size_by_type(const Handle&, const Handle&, Type);
+	void do_declare_marginal(const Handle&, Type, const Handle&);
+	ValuePtr do_marginal(const Handle&, const Handle&, Type,
+	                     const Handle&, size_t);
+	HandleSeq do_load_by_key(const Handle&, const Handle&);
+	void do_drop_key(const Handle&, const Handle&);
+	void do_declare_order(const Handle&, const Handle&, size_t);
+	HandleSeq do_load_top(const Handle&, const Handle&, size_t, size_t);
+	HandleSeq do_load_where(const Handle&, const Handle&, size_t, double);
+	HandleSeq do_load_type_where(const Handle&, Type, const Handle&,
+	                             size_t, double);
+	HandleSeq do_nodes_by_prefix(const Handle&, Type, const std::string&,
+	                             size_t);
+	size_t do_delete_type(const Handle&, Type, bool);
+	void do_remove_atoms(const Handle&, const HandleSeq&, bool);
 }; // class
 
 /** @}*/
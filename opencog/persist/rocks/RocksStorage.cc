@@ -28,6 +28,7 @@
  */
 
 #include <filesystem>
+#include <sstream>
 #include <sys/resource.h>
 
 #include "rocksdb/db.h"
@@ -46,6 +47,11 @@ using namespace opencog;
 
 static const char* aid_key = "*-NextUnusedAID-*";
 static const char* version_key = "*-Version-*";
+static const char* layout_key = "*-FrameLayout-*";
+static const char* counts_key = "*-FrameCounts-*";
+static const char* global_counts_key = "*-GlobalCounts-*";
+static const char* incoming_counts_key = "*-IncomingCounts-*";
+static const char* key_index_key = "*-KeyIndex-*";
 
 /* ================================================================ */
 // Constructors
@@ -57,6 +63,10 @@ void RocksStorage::init(const char * uri, bool read_only)
 	//    rocks:///path/to/file
 	std::string file(uri + URIX_LEN);
 
+	// Strip off the options, if any.
+	size_t qmark = file.find('?');
+	if (std::string::npos != qmark) file.resize(qmark);
+
 	rocksdb::Options options;
 	options.IncreaseParallelism();
 
@@ -101,6 +111,9 @@ void RocksStorage::init(const char * uri, bool read_only)
 
 	options.max_open_files = max_of;
 
+	// Counters are updated with merges. See RocksCount.cc
+	options.merge_operator = countMerger();
+
 #if 0
 	// According to the RocksDB wiki, Bloom filters should make
 	// everything go faster for us, since we use lots of Get()'s.
@@ -113,17 +126,35 @@ void RocksStorage::init(const char * uri, bool read_only)
 	options.table_factory.reset(tfactory);
 #endif
 
+	// All of the column families must be opened, even the ones we
+	// don't use. A new file has only the default family.
+	std::vector<std::string> cfnames;
+	rocksdb::Status s = rocksdb::DB::ListColumnFamilies(options, file, &cfnames);
+	if (not s.ok() or 0 == cfnames.size())
+		cfnames = {rocksdb::kDefaultColumnFamilyName};
+
+	// Families created later, for new frames, get the same options,
+	// so that Values in them can be merged.
+	_family_options = rocksdb::ColumnFamilyOptions(options);
+
+	std::vector<rocksdb::ColumnFamilyDescriptor> cfds;
+	for (const std::string& cfname : cfnames)
+		cfds.push_back(rocksdb::ColumnFamilyDescriptor(cfname, options));
+
 	// Open the file.
-	rocksdb::Status s;
+	std::vector<rocksdb::ColumnFamilyHandle*> cfhs;
 	if (read_only)
-		s = rocksdb::DB::OpenForReadOnly(options, file, &_rfile);
+		s = rocksdb::DB::OpenForReadOnly(options, file, cfds, &cfhs, &_rfile);
 	else
-		s = rocksdb::DB::Open(options, file, &_rfile);
+		s = rocksdb::DB::Open(options, file, cfds, &cfhs, &_rfile);
 
 	if (not s.ok())
 		throw IOException(TRACE_INFO, "Can't open file: %s",
 			s.ToString().c_str());
 
+	for (size_t i=0; i<cfhs.size(); i++)
+		_families.emplace(cfnames[i], cfhs[i]);
+
 	_read_only = read_only;
 
 	// Does the file contain multiple atomspaces?
@@ -139,6 +170,13 @@ void RocksStorage::init(const char * uri, bool read_only)
 	// Version 1 DB's might have frames. They work with current code.
 	// Version 2 DB's have frame reversed indexes ("o@") for frame
 	//    deletion. Frames cannot be deleted without this. Added Oct 2022.
+	// Version 3 DB's have a complete "o@" index: every frame that
+	//    holds a "k@" record for an Atom is listed. Version 2 only
+	//    listed the frame in which the Atom first appeared. Frame
+	//    loads use this index.
+	// Version 4 DB's have an "s@" record for every Link, listing the
+	//    sids of its outgoing set. Deletes use this, instead of
+	//    taking the s-expression apart. Added for faster deletes.
 	std::string version;
 	s = _rfile->Get(rocksdb::ReadOptions(), version_key, &version);
 	if (not s.ok())
@@ -146,20 +184,96 @@ void RocksStorage::init(const char * uri, bool read_only)
 		if (read_only)
 			throw IOException(TRACE_INFO,
 				"Cannot open read-only: DB has no version (not initialized)");
-		_rfile->Put(rocksdb::WriteOptions(), version_key, "2");
+		version = "4";
+		_rfile->Put(rocksdb::WriteOptions(), version_key, version);
 	}
 	else
 	{
 		if (0 != version.compare("1") and
-		    0 != version.compare("2"))
+		    0 != version.compare("2") and
+		    0 != version.compare("3") and
+		    0 != version.compare("4"))
 			throw IOException(TRACE_INFO,
 				"Unsupported DB version '%s'\n", version.c_str());
 
-		// If it's version 1, and does not (yet) contain multiple
-		// spaces, it is safe to upgrade to version 2.
+		// Older versions can be upgraded by rebuilding the frame
+		// index. If there are no frames, there is nothing to do.
+		// Then the outgoing sets are indexed.
 		// Skip upgrade in read-only mode.
-		if (not read_only and 0 == version.compare("1") and not _multi_space)
-			_rfile->Put(rocksdb::WriteOptions(), version_key, "2");
+		if (not read_only and 0 != version.compare("4"))
+		{
+			if (_multi_space and 0 != version.compare("3")) indexFrames();
+			indexOutgoing();
+			version = "4";
+			_rfile->Put(rocksdb::WriteOptions(), version_key, version);
+		}
+	}
+	_frame_index = (0 == version.compare("3") or 0 == version.compare("4"));
+
+	// Which frame layout? It can only be chosen before there are
+	// any frames; after that, it's whatever the DB says.
+	std::string layout;
+	s = _rfile->Get(rocksdb::ReadOptions(), layout_key, &layout);
+	if (not s.ok() and _want_families and not _multi_space and not read_only)
+	{
+		layout = "column-families";
+		_rfile->Put(rocksdb::WriteOptions(), layout_key, layout);
+	}
+	_frame_families = (0 == layout.compare("column-families"));
+
+	// Older DB's don't have frame counters. Compute them now.
+	std::string counted;
+	s = _rfile->Get(rocksdb::ReadOptions(), counts_key, &counted);
+	_frame_counts = s.ok();
+	if (not _frame_counts and not read_only)
+	{
+		if (_multi_space) countFrames();
+		_rfile->Put(rocksdb::WriteOptions(), counts_key, "1");
+		_frame_counts = true;
+	}
+
+	s = _rfile->Get(rocksdb::ReadOptions(), global_counts_key, &counted);
+	_global_counts = s.ok();
+	if (not _global_counts and not read_only)
+	{
+		countAll();
+		_rfile->Put(rocksdb::WriteOptions(), global_counts_key, "1");
+		_global_counts = true;
+	}
+
+	s = _rfile->Get(rocksdb::ReadOptions(), incoming_counts_key, &counted);
+	_incoming_counts = s.ok();
+	if (not _incoming_counts and not read_only)
+	{
+		countIncomings();
+		_rfile->Put(rocksdb::WriteOptions(), incoming_counts_key, "1");
+		_incoming_counts = true;
+	}
+
+	// The key index is kept from the first time it is asked for.
+	s = _rfile->Get(rocksdb::ReadOptions(), key_index_key, &counted);
+	_key_index = s.ok();
+	if (not _key_index and _want_key_index and not read_only)
+	{
+		buildKeyIndex();
+		_rfile->Put(rocksdb::WriteOptions(), key_index_key, "1");
+		_key_index = true;
+	}
+
+	if (_multi_space) loadViews();
+	else
+	{
+		loadMarginals();
+		loadOrders();
+	}
+
+	// Finish cleaning up any frames that were deleted earlier.
+	if (_multi_space and not read_only)
+	{
+		auto tt = _rfile->NewIterator(rocksdb::ReadOptions());
+		for (tt->Seek("T@"); tt->Valid() and tt->key().starts_with("T@"); tt->Next())
+			queueClean(tt->key().ToString().substr(2));
+		delete tt;
 	}
 
 	// If the file was created just now, then set the UUID to 1.
@@ -204,23 +318,63 @@ RocksStorage::RocksStorage(std::string uri) :
 	_multi_space(false),
 	_read_only(false),
 	_unknown_type(false),
+	_frame_index(false),
+	_frames(std::make_shared<FrameTables>()),
+	_frames_loaded(false),
+	_want_families(false),
+	_frame_families(false),
+	_cleaning(false),
+	_frame_counts(false),
+	_global_counts(false),
+	_incoming_counts(false),
+	_merge_values(false),
+	_want_key_index(false),
+	_key_index(false),
 	_next_aid(0)
 {
 	const char *yuri = _name.c_str();
 
 	// We expect the URI to be for the form (note: three slashes)
 	//    rocks:///path/to/file
+	// optionally followed by `?column-families`, to put each frame
+	// in a column family of its own (see RocksFamily.cc) and/or by
+	// `merge-values`, to write only the deltas in updateValue(), as
+	// in `rocks:///path/to/file?column-families&merge-values`, and/or
+	// by `key-index`, to index Atoms by key (see RocksKeyIndex.cc).
 	if (strncmp(yuri, "rocks://", URIX_LEN))
 		throw IOException(TRACE_INFO,
 			"Unknown URI '%s'\nValid URI's start with 'rocks://'\n", yuri);
 
+	std::string file(yuri + URIX_LEN);
+	std::string query;
+	size_t qmark = file.find('?');
+	if (std::string::npos != qmark)
+	{
+		query = file.substr(qmark);
+		file.resize(qmark);
+
+		std::stringstream opts(query.substr(1));
+		std::string opt;
+		while (std::getline(opts, opt, '&'))
+		{
+			if (0 == opt.compare("column-families"))
+				_want_families = true;
+			else if (0 == opt.compare("merge-values"))
+				_merge_values = true;
+			else if (0 == opt.compare("key-index"))
+				_want_key_index = true;
+			else
+				throw IOException(TRACE_INFO,
+					"Unknown URI option '%s'\n", opt.c_str());
+		}
+	}
+
 	// Normalize the filename. This avoids multiple different
 	// StorageNodes referring to exactly the same file.
-	std::string file(yuri + URIX_LEN);
 	std::filesystem::path fpath(file);
 	std::filesystem::path npath(fpath.lexically_normal());
 	file = npath.string();
-	_uri = "rocks://" + file;
+	_uri = "rocks://" + file + query;
 	_name = _uri;
 }
 
@@ -233,11 +387,15 @@ void RocksStorage::close()
 {
 	if (nullptr == _rfile) return;
 
+	// Finish deleting any deleted frames.
+	waitForCleaner();
+
 	if (not _read_only)
 	{
 		logger().debug("Rocks: storing final aid=%lu\n", _next_aid.load());
 		write_aid();
 	}
+	closeFamilies();
 	delete _rfile;
 	_rfile = nullptr;
 	_next_aid = 0;
@@ -245,9 +403,37 @@ void RocksStorage::close()
 	// Invalidate the local cache.
 	_multi_space = false;
 	_read_only = false;
-	_frame_map.clear();
-	_fid_map.clear();
-	_top_frames.clear();
+	_frame_index = false;
+	_frame_families = false;
+	_frame_counts = false;
+	_global_counts = false;
+	_incoming_counts = false;
+	_key_index = false;
+	{
+		std::lock_guard<std::mutex> flck(_mtx_frame);
+		resetFrames();
+	}
+	_frame_filters.clear();
+	_frames_loaded = false;
+	_views.clear();
+	_marginals.clear();
+	_orders.clear();
+}
+
+/// Close the database, and delete the files holding it. There is no
+/// coming back from this.
+void RocksStorage::destroy(void)
+{
+	close();
+
+	std::string file(_name.c_str() + URIX_LEN);
+	size_t qmark = file.find('?');
+	if (std::string::npos != qmark) file.resize(qmark);
+
+	rocksdb::Status s = rocksdb::DestroyDB(file, rocksdb::Options());
+	if (not s.ok())
+		throw IOException(TRACE_INFO, "Can't delete file: %s",
+			s.ToString().c_str());
 }
 
 std::string RocksStorage::get_version(void)
@@ -269,6 +455,28 @@ void RocksStorage::write_aid(void)
 	_rfile->Put(rocksdb::WriteOptions(), aid_key, sid);
 }
 
+/// Write back the markers describing the DB, after it was wiped.
+/// An empty DB is current, and has nothing left to count or index.
+void RocksStorage::write_markers(void)
+{
+	// With no frames left, the layout can be chosen over again.
+	if (_want_families) _frame_families = true;
+
+	_rfile->Put(rocksdb::WriteOptions(), version_key, "4");
+	if (_frame_families)
+		_rfile->Put(rocksdb::WriteOptions(), layout_key, "column-families");
+	_rfile->Put(rocksdb::WriteOptions(), counts_key, "1");
+	_rfile->Put(rocksdb::WriteOptions(), global_counts_key, "1");
+	_rfile->Put(rocksdb::WriteOptions(), incoming_counts_key, "1");
+	if (_key_index)
+		_rfile->Put(rocksdb::WriteOptions(), key_index_key, "1");
+
+	_frame_index = true;
+	_frame_counts = true;
+	_global_counts = true;
+	_incoming_counts = true;
+}
+
 std::string RocksStorage::get_new_aid(void)
 {
 	uint64_t aid = _next_aid.fetch_add(1);
@@ -299,6 +507,8 @@ bool RocksStorage::connected(void)
 void RocksStorage::barrier(AtomSpace* as)
 {
 	if (_read_only) return;
+	waitForCleaner();
+
 	// belt and suspenders.
 	write_aid();
 }
@@ -320,21 +530,34 @@ std::string RocksStorage::monitor(void)
 		return rs;
 	}
 
+	// Use the counters, if there are any. Older DB's opened read-only
+	// won't have them; do it the hard way.
+	auto count = [&](const std::string& pfx) -> std::string {
+		if (_global_counts) return std::to_string(getCount("C@" + pfx));
+		return std::to_string(count_records(pfx));
+	};
+
 	rs += "Database contents:\n";
 	rs += "  Version: " + get_version();
 	rs += "  Multispace: " + std::to_string(_multi_space);
 	rs += "\n";
 	rs += "  Next aid: " + std::to_string(_next_aid.load());
-	rs += "  Frame count f@: " + std::to_string(count_records("f@"));
+	rs += "  Frame count f@: " + count("f@");
 	rs += "\n";
-	rs += "  Atom/Link/Node count a@: " + std::to_string(count_records("a@"));
-	rs += " l@: " + std::to_string(count_records("l@"));
-	rs += " n@: " + std::to_string(count_records("n@"));
+	rs += "  Atom/Link/Node count a@: " + count("a@");
+	rs += " l@: " + count("l@");
+	rs += " n@: " + count("n@");
 	rs += "\n";
-	rs += "  Keys/Incoming/Hash count k@: " + std::to_string(count_records("k@"));
-	rs += " i@: " + std::to_string(count_records("i@"));
-	rs += " h@: " + std::to_string(count_records("h@"));
+	rs += "  Values/Incoming/Hash count k@: " + count("k@");
+	rs += " i@: " + count("i@");
+	rs += " h@: " + count("h@");
 	rs += "\n";
+	if (_multi_space)
+	{
+		rs += "  Materialized views V@: " + std::to_string(count_records("V@"));
+		rs += " v@: " + std::to_string(count_records("v@"));
+		rs += "\n";
+	}
 
 	if (_multi_space)
 	{
@@ -344,9 +567,9 @@ std::string RocksStorage::monitor(void)
 		while (true)
 		{
 			std::string zed = "z" + aidtostr(height) + "@";
-			size_t nrec = count_records(zed);
-			if (0 == nrec) break;
-			rs += "    " + zed + ": " + std::to_string(nrec) + "\n";
+			const std::string& nrec = count(zed);
+			if (0 == nrec.compare("0")) break;
+			rs += "    " + zed + ": " + nrec + "\n";
 			height ++;
 		}
 
@@ -359,7 +582,7 @@ std::string RocksStorage::monitor(void)
 		for (const Handle& ht: tops)
 		{
 			rs += "  Frame top: `" + AtomSpaceCast(ht)->get_name() + "`\n";
-			rs += "  Size   Name\n";
+			rs += "  Atoms  Values  Name\n";
 			// total order
 			std::map<uint64_t, Handle> totor;
 			makeOrder(ht, totor);
@@ -367,9 +590,21 @@ std::string RocksStorage::monitor(void)
 			{
 				const Handle& hasp = pr.second;
 				const AtomSpacePtr asp = AtomSpaceCast(hasp);
-				std::string fid = aidtostr(pr.first);
-				size_t nrec = count_records("o@" + fid);
-				rs += "    " + std::to_string(nrec) + "\t`";
+				std::string fidc = aidtostr(pr.first) + ":";
+				int64_t natoms, nvals = -1;
+				if (_frame_counts)
+				{
+					natoms = getCount("c@" + fidc + "a");
+					nvals = getCount("c@" + fidc + "v");
+				}
+				else
+				{
+					std::vector<std::string> members;
+					getFrameMembers(fidc, members);
+					natoms = members.size();
+				}
+				rs += "    " + std::to_string(natoms) + "\t";
+				rs += (0 <= nvals ? std::to_string(nvals) : "?") + "\t`";
 				rs += asp->get_name() + "`\n";
 			}
 		}
@@ -31,8 +31,12 @@
 #define _ATOMSPACE_ROCKS_STORAGE_H
 
 #include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
 #include "rocksdb/db.h"
 
 #include <opencog/atomspace/AtomSpace.h>
@@ -64,36 +68,225 @@ class RocksStorage : public StorageNode
 		// Exception due to unknown Atom type.
 		bool _unknown_type;
 
+		// True if the "o@" frame membership index is complete.
+		bool _frame_index;
+
+		typedef std::map<uint64_t, Handle> FramePath;
+		typedef std::shared_ptr<const FramePath> FramePathPtr;
+		typedef std::vector<std::pair<std::string, std::string>> KeyVals;
+
+		// The frame tables. These are published as immutable
+		// snapshots: readers grab the current one without locking,
+		// and writers (holding _mtx_frame) publish a modified copy.
 		// The Handles are *always* AtomSpacePtr's
-		std::unordered_map<Handle, const std::string> _frame_map;
-		std::unordered_map<std::string, Handle> _fid_map;
-		UnorderedHandleSet _top_frames;
+		struct FrameTables
+		{
+			std::unordered_map<Handle, std::string> frame_map;
+			std::unordered_map<std::string, Handle> fid_map;
+			UnorderedHandleSet top_frames;
+
+			// Frames merged away by squashFrames(). These must not
+			// be written to, or read from, again.
+			UnorderedHandleSet squashed;
+
+			// Bumped whenever frames are forgotten. Cached paths
+			// are good only for the generation they were made in.
+			uint64_t generation = 0;
+		};
+		typedef std::shared_ptr<const FrameTables> FrameTablesPtr;
+		FrameTablesPtr _frames;
+		FrameTablesPtr frameTables(void) const {
+			return std::atomic_load(&_frames);
+		}
+		void publishFrames(std::shared_ptr<FrameTables>&&);
+		void resetFrames(void);
+		void checkSquashed(const FrameTablesPtr&, const Handle&);
+
+		// The paths, from each frame down to the bottom. These are
+		// kept apart from the frame tables, so that caching a path
+		// does not copy the tables. Sharded, so that fetches from
+		// different frames rarely wait on one another.
+		struct PathShard
+		{
+			std::mutex mtx;
+			std::unordered_map<Handle, FramePathPtr> paths;
+			uint64_t generation = 0;
+		};
+		static const size_t PATH_SHARDS = 16;
+		PathShard _path_cache[PATH_SHARDS];
+
+		std::atomic_bool _frames_loaded;
+		void insertFrame(FrameTables&, const Handle&, const std::string&);
 		void updateFrameMap(const Handle&, const std::string&);
-		typedef std::map<uint64_t, Handle> FramePath;
-		const FramePath& getPath(const Handle&);
+		FramePathPtr getPath(const Handle&);
+		static FramePathPtr noPath(void);
 		void makeOrder(Handle, FramePath&);
-		std::unordered_map<Handle, FramePath> _path_cache;
 
 		std::mutex _mtx_frame;
-		std::string encodeFrame(const Handle&);
+		std::string encodeFrame(const Handle&, bool create = true);
 		std::string writeFrame(const Handle&);
+		std::string findFrame(const Handle&);
 		std::string writeFrame(AtomSpace* as) {
 			if (nullptr == as) return "0";
 			return writeFrame(HandleCast(as));
 		}
-		Handle decodeFrame(const std::string&);
+		Handle decodeFrame(const std::string&, FrameTables&);
 		Handle getFrame(const std::string&);
+		Handle getFrame(const std::string&, FrameTables&);
 		bool checkFrames(void);
 		void scrubFrames(void);
 		HandleSeq topFrames(void);
 
 		void convertForFrames(const Handle&);
 
+		// Optional layout, with the k@ and o@ records of each frame
+		// in a column family of its own. See RocksFamily.cc
+		bool _want_families;
+		bool _frame_families;
+		std::unordered_map<std::string, rocksdb::ColumnFamilyHandle*> _families;
+		std::vector<rocksdb::ColumnFamilyHandle*> _dropped_families;
+		std::mutex _mtx_family;
+		rocksdb::ColumnFamilyOptions _family_options;
+		rocksdb::ColumnFamilyHandle* frameFamily(const std::string&,
+		                                         bool create = true);
+		std::string keyPrefix(const std::string&, const std::string&);
+		std::string memberPrefix(const std::string&);
+		void getFrameKeys(const std::string&, const FramePath&,
+		                  std::map<uint64_t, KeyVals>&);
+		void getFrameMembers(const std::string&, std::vector<std::string>&);
+		bool hasFrameKeys(const std::string&);
+		void dropFamily(const std::string&);
+		void closeFamilies(void);
+
+		// Deleted frames are cleaned up in the background.
+		std::deque<std::string> _clean_queue;
+		std::thread _cleaner;
+		std::mutex _mtx_clean;
+		bool _cleaning;
+		void queueClean(const std::string&);
+		void cleanFrames(void);
+		void cleanFrame(const std::string&);
+		void waitForCleaner(void);
+
+		// Bloom filters over the aid's of the Atoms in each frame,
+		// built from the "o@" index. Keyed by the frame aid.
+		struct SidFilter
+		{
+			std::vector<uint64_t> bits;
+			size_t count = 0;
+			void add(uint64_t);
+			bool has(uint64_t) const;
+		};
+		std::unordered_map<uint64_t, SidFilter> _frame_filters;
+		std::mutex _mtx_filter;
+
+		// Filters being built, without the lock, and the aid's of the
+		// Atoms added to those frames in the meantime.
+		struct FilterBuild
+		{
+			size_t builders = 0;
+			std::vector<uint64_t> added;
+		};
+		std::unordered_map<uint64_t, FilterBuild> _filter_builds;
+		size_t _filter_epoch = 0;
+		void addToFrame(const std::string&, const std::string&);
+		void addToFilter(const std::string&, const std::string&);
+		bool buildFilter(uint64_t, uint64_t);
+		void clearFilters(void);
+		bool inPath(const FramePath&, const std::string&);
+		void indexFrames(void);
+
+		// Counters, kept up to date with a merge operator.
+		// See RocksCount.cc
+		bool _frame_counts;
+		bool _global_counts;
+		bool _incoming_counts;
+		bool _merge_values;
+		static std::shared_ptr<rocksdb::MergeOperator> countMerger(void);
+		void addCount(const std::string&, int64_t);
+		void addCount(rocksdb::WriteBatch&, const std::string&, int64_t);
+		int64_t getCount(const std::string&);
+		void countFrames(void);
+		void countAtom(const std::string&, bool, int64_t);
+		void countAtom(rocksdb::WriteBatch&, const std::string&, bool, int64_t);
+		void countAll(void);
+		void countIncoming(rocksdb::WriteBatch&, const std::string&, int64_t);
+		void countIncomings(void);
+
+		// A record that is counted is checked for, and written, under
+		// the lock for its Atom, so that it is counted only once.
+		static const size_t SID_LOCKS = 64;
+		std::mutex _mtx_sids[SID_LOCKS];
+		std::mutex& sidLock(const std::string&);
+		void lockSids(const std::set<std::string>&,
+		              std::vector<std::unique_lock<std::mutex>>&);
+
+		// Materialized views: the resolved Values of each Atom, as
+		// seen from a chosen frame. Keyed by the frame aid; the path
+		// is filled in when first needed. Writers share the view
+		// lock; the records of any one Atom are updated under one
+		// of the `_mtx_view_sids`.
+		std::map<uint64_t, FramePath> _views;
+		std::shared_mutex _mtx_view;
+		static const size_t VIEW_LOCKS = 64;
+		std::mutex _mtx_view_sids[VIEW_LOCKS];
+		void loadViews(void);
+		std::string viewPrefix(AtomSpace*);
+		void updateViews(const std::string&, const std::string&);
+		KeyVals resolveKeys(const std::map<uint64_t, KeyVals>&,
+		                    uint64_t* = nullptr);
+		void refreshView(uint64_t, const FramePath&, const std::string&);
+		void updateView(uint64_t, const FramePath&,
+		                const std::string&, const std::string&);
+		void writeView(const std::string&, uint64_t, const KeyVals&);
+		void writeView(rocksdb::WriteBatch&, const std::string&,
+		               uint64_t, const KeyVals&);
+		void getKeysView(AtomSpace*, const FramePath&, const std::string&,
+		                 const std::string&, const Handle&);
+		void dropView(const std::string&);
+
+		// Sums of Values over incoming sets. See RocksMarginal.cc
+		std::set<std::string> _marginals;
+		std::mutex _mtx_marginal;
+		std::mutex _mtx_store_marginal;
+
+		// Single-space stores and deletes of Values share this lock;
+		// declareMarginal() and declareOrder() take it for themselves,
+		// so that no store can miss a declaration made while it runs.
+		std::shared_mutex _mtx_declare;
+		void loadMarginals(void);
+		std::string marginalId(const Handle&, const std::string&);
+		void addMarginals(const Handle&, const std::string&,
+		                  const std::vector<double>&);
+		void storeMarginal(const std::string&, const Handle&,
+		                   const std::string&, const ValuePtr&);
+		void removeMarginal(const std::string&, const std::string&,
+		                    const std::string&);
+
+		// Reverse index, from keys to Atoms. See RocksKeyIndex.cc
+		bool _want_key_index;
+		bool _key_index;
+		void indexKey(rocksdb::WriteBatch&, const std::string&);
+		void unindexKey(rocksdb::WriteBatch&, const std::string&);
+		void buildKeyIndex(void);
+		void keySids(const std::string&, std::vector<std::string>&);
+
+		// Atoms sorted by a number in a Value. See RocksOrder.cc
+		std::map<std::string, std::set<size_t>> _orders;
+		std::mutex _mtx_order;
+		void loadOrders(void);
+		std::set<size_t> orderIndexes(const std::string&);
+		void storeOrdered(const std::string&, const std::string&,
+		                  const std::set<size_t>&);
+		void removeOrdered(rocksdb::WriteBatch&, const std::string&,
+		                   const std::string&, const std::string&);
+
 		// unique ID's
 		std::atomic_uint64_t _next_aid;
 		uint64_t strtoaid(const std::string&) const;
 		std::string aidtostr(uint64_t) const;
 		void write_aid(void);
+		void write_markers(void);
 		std::string get_new_aid(void);
 
 		// Issue of sid needs to be atomic.
@@ -105,31 +298,47 @@ class RocksStorage : public StorageNode
 		std::string writeAtom(const Handle&, bool = true);
 		void appendToSidList(const std::string&, const std::string&);
 		void remFromSidList(const std::string&, const std::string&);
-		void storeValue(const std::string& skid,
+		void storeValue(rocksdb::ColumnFamilyHandle*,
+		                const std::string& fidc,
+		                const std::string& skid,
 		                const ValuePtr& vp);
+		void writeValue(const Handle&, const Handle&, const ValuePtr&);
 		void storeMissingAtom(AtomSpace*, const Handle&);
 		void doRemoveAtom(const Handle&, bool recursive);
 
-		ValuePtr getValue(const std::string&);
+		ValuePtr getValue(const std::string&,
+		                  rocksdb::ColumnFamilyHandle* = nullptr);
 		Handle getAtom(const std::string&);
 		Handle findAlpha(const Handle&, const std::string&, std::string&);
 		void getKeysMonospace(AtomSpace*, const std::string&, const Handle&);
-		void getKeysMulti(AtomSpace*, const std::string&, const Handle&);
+		void getKeysMulti(const FramePath&, const std::string&, const Handle&);
+		void applyFrameKeys(AtomSpace*, const KeyVals&, const Handle&);
 		void loadAtoms(AtomSpace*);
 		size_t loadAtomsPfx(const FramePath&,
 		                    const std::string&);
 		size_t loadAtomsHeight(const std::map<uint64_t, Handle>&,
 		                       size_t);
 		void loadAtomsAllFrames(AtomSpace*);
+		void loadFrameMembers(const FramePath&);
 		void loadTypeMonospace(AtomSpace*, Type);
 		void loadTypeAllFrames(AtomSpace*, Type);
+		Handle loadSid(AtomSpace*, const FramePath&,
+		               const std::string&, const Handle&);
+		bool isVisible(const FramePath&, const std::string&);
+		bool isWhere(const FramePath&, const std::string&,
+		             const std::string&, size_t, double);
 		void loadInset(AtomSpace*, const std::string& ist);
 		void appendToInset(const std::string&, const std::string&);
 		void remFromInset(const std::string&, const std::string&);
 
 		void removeSatom(const std::string&, const std::string&, bool, bool);
-		void remIncoming(const std::string&, const std::string&,
-		                 const std::string&);
+		std::string findSatom(const std::string&);
+		void batchRemove(rocksdb::WriteBatch&, std::map<std::string, int64_t>&,
+		                 const std::string&, const std::string&,
+		                 const std::set<std::string>&);
+		std::vector<std::string> outgoingSids(const std::string&,
+		                                      const std::string&);
+		void indexOutgoing(void);
 
 		size_t count_records(const std::string&);
 
@@ -145,7 +354,7 @@ class RocksStorage : public StorageNode
 		bool connected(void); // connection to DB is alive
 
 		void create(void) {}
-		void destroy(void) { kill_data(); /* TODO also delete the db */ }
+		void destroy(void); // Delete the DB files
 		void erase(void) { kill_data(); }
 
 		void kill_data(void); // destroy DB contents
@@ -167,9 +376,36 @@ class RocksStorage : public StorageNode
 		HandleSeq loadFrameDAG(void);   // Load AtomSpace DAG
 		void storeFrameDAG(AtomSpace*); // Store AtomSpace DAG
 		void deleteFrame(AtomSpace*);   // Delete the entire frame
+		void squashFrames(AtomSpace*, size_t); // Merge a run of frames
+		void diffFrames(AtomSpace*, AtomSpace*,  // Compare two frames
+		                HandleSeq&, HandleSeq&, HandleSeq&);
 		void barrier(AtomSpace* = nullptr);
 		std::string monitor();
 
+		// Partial loads, not part of the BackingStore API.
+		HandleSeq sampleAtoms(AtomSpace*, Type, size_t, uint64_t seed);
+		std::string loadAtomSpaceChunk(AtomSpace*, const std::string&,
+		                               size_t budget);
+		void materializeView(AtomSpace*);
+		void dropView(AtomSpace*);
+		size_t countType(Type);
+		size_t getIncomingSize(const Handle&);
+		size_t getIncomingSize(const Handle&, Type);
+		void declareMarginal(Type, const Handle&);
+		ValuePtr getMarginal(const Handle&, Type, const Handle&, size_t);
+		HandleSeq loadByKey(AtomSpace*, const Handle&);
+		void dropKey(const Handle&);
+		void declareOrder(const Handle&, size_t);
+		HandleSeq loadTopK(AtomSpace*, const Handle&, size_t, size_t);
+		HandleSeq loadTypeWhere(AtomSpace*, Type, const Handle&,
+		                        size_t, double);
+		HandleSeq loadAtomSpaceWhere(AtomSpace*, const Handle&,
+		                             size_t, double);
+		HandleSeq findNodesByPrefix(AtomSpace*, Type, const std::string&,
+		                            size_t);
+		size_t deleteType(Type, bool);
+		void removeAtoms(AtomSpace*, const HandleSeq&, bool);
+
 		// Debugging and performance monitoring
 		void print_stats(void);
 		void clear_stats(void); // reset stats counters.
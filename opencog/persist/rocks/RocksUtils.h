@@ -30,4 +30,15 @@
 		throw IOException(TRACE_INFO, "RocksDB is not open! %s", \
 			_name.c_str());
 
+// Number of deletes to batch together.
+#define CLEAN_BATCH_SIZE 10000
+
+/// The end of the range of keys starting with `pfx`, for use with
+/// DeleteRange(). All keys with the prefix sort before this.
+static inline std::string prefix_end(std::string pfx)
+{
+	pfx.back() ++;
+	return pfx;
+}
+
 // ======================== THE END ======================
@@ -0,0 +1,369 @@
+/*
+ * RocksView.cc
+ * Materialized views of the Values seen from a frame.
+ *
+ * Copyright (c) 2022 Linas Vepstas <linas@linas.org>
+ *
+ * LICENSE:
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <unordered_set>
+
+#include "rocksdb/write_batch.h"
+
+#include <opencog/atomspace/AtomSpace.h>
+
+#include "RocksStorage.h"
+#include "RocksUtils.h"
+
+using namespace opencog;
+
+// ======================================================================
+// Fetching an Atom from the top of a deep stack of frames requires
+// replaying the Values in every frame, from the bottom up. Most of
+// that work is thrown away: only the top-most frame holding Values
+// for the Atom matters. A materialized view holds a copy of just those
+// records, under `v@fid:sid:vfid:`, where `fid` is the frame the view
+// is for, and `vfid` is the frame the records were copied from. They
+// are updated whenever an Atom is stored into any frame on the path,
+// so that a fetch is a single short scan.
+//
+// The frames having views are recorded with `V@fid` keys.
+
+/// Load the list of frames that have views. The frame paths are
+/// computed later, as needed.
+void RocksStorage::loadViews(void)
+{
+	std::lock_guard<std::shared_mutex> lck(_mtx_view);
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek("V@"); it->Valid() and it->key().starts_with("V@"); it->Next())
+		_views.emplace(strtoaid(it->key().ToString().substr(2)), FramePath());
+	delete it;
+}
+
+/// Return the `v@fid:` prefix for the view of `as`, or the empty
+/// string, if it does not have one.
+std::string RocksStorage::viewPrefix(AtomSpace* as)
+{
+	if (nullptr == as) return "";
+	{
+		std::shared_lock<std::shared_mutex> lck(_mtx_view);
+		if (_views.empty()) return "";
+	}
+
+	const std::string& fid = findFrame(HandleCast(as));
+	if (0 == fid.size()) return "";
+
+	std::shared_lock<std::shared_mutex> lck(_mtx_view);
+	if (_views.end() == _views.find(strtoaid(fid))) return "";
+	return "v@" + fid + ":";
+}
+
+/// The Atom `sid` was just changed in the frame `fidc`. Update it in
+/// every view that can see that frame. The `fidc` must be the fid,
+/// followed by a colon.
+///
+/// Stores of different Atoms update the views concurrently; stores
+/// of the same Atom take turns.
+void RocksStorage::updateViews(const std::string& fidc, const std::string& sid)
+{
+	std::shared_lock<std::shared_mutex> lck(_mtx_view);
+	if (_views.empty()) return;
+
+	// Compute any paths that aren't known yet. This needs the frame
+	// lock, and deleteFrame() takes the view lock while holding that.
+	// So don't hold the view lock here.
+	std::vector<uint64_t> unknown;
+	for (const auto& vpr : _views)
+		if (vpr.second.empty()) unknown.push_back(vpr.first);
+
+	if (0 < unknown.size())
+	{
+		lck.unlock();
+		std::map<uint64_t, FramePath> paths;
+		for (uint64_t taid : unknown)
+			paths.emplace(taid, *getPath(getFrame(aidtostr(taid))));
+		{
+			std::lock_guard<std::shared_mutex> xlck(_mtx_view);
+			for (auto& ppr : paths)
+			{
+				auto vit = _views.find(ppr.first);
+				if (_views.end() != vit and vit->second.empty())
+					vit->second = std::move(ppr.second);
+			}
+		}
+		lck.lock();
+	}
+
+	std::lock_guard<std::mutex> slck(
+		_mtx_view_sids[std::hash<std::string>()(sid) % VIEW_LOCKS]);
+
+	uint64_t faid = strtoaid(fidc.substr(0, fidc.size()-1));
+	for (const auto& vpr : _views)
+	{
+		const FramePath& path = vpr.second;
+		if (path.end() == path.find(faid)) continue;
+		updateView(vpr.first, path, fidc, sid);
+	}
+}
+
+/// Given the records for one Atom, in several frames, return the
+/// records that getKeysMulti() would leave behind, if they were all
+/// in one frame. A `+` marker only says that the Atom is in the frame;
+/// Values from the frames underneath it are still visible. A `+` over
+/// a `-` hides whatever is underneath both; the `+` is then marked
+/// with a `-` Value, so that it still does, when it is all that is
+/// left. If `faid` is not null, it is set to the aid of the frame that
+/// getKeysMulti() would leave the Atom in.
+RocksStorage::KeyVals
+RocksStorage::resolveKeys(const std::map<uint64_t, KeyVals>& frame_keys,
+                          uint64_t* faid)
+{
+	uint64_t present = 0;
+	bool hides = false;
+	for (auto fk = frame_keys.rbegin(); fk != frame_keys.rend(); fk++)
+	{
+		const KeyVals& kvs = fk->second;
+		if ('+' == kvs[0].first[0])
+		{
+			present = fk->first;
+			if (0 < kvs[0].second.size() and '-' == kvs[0].second[0])
+			{
+				hides = true;
+				break;
+			}
+			continue;
+		}
+		if ('-' == kvs[0].first[0] and present)
+		{
+			hides = true;
+			break;
+		}
+		if (faid) *faid = fk->first;
+		return kvs;
+	}
+	if (faid) *faid = present;
+	if (present) return KeyVals({{"+1", hides ? "-" : ""}});
+	return KeyVals();
+}
+
+/// Rewrite the view records for `sid` in the view of frame `taid`,
+/// from the records in all of the frames on the path. Must be called
+/// with the view lock for `sid` held.
+void RocksStorage::refreshView(uint64_t taid, const FramePath& path,
+                               const std::string& sid)
+{
+	std::map<uint64_t, KeyVals> frame_keys;
+	getFrameKeys(sid, path, frame_keys);
+
+	uint64_t faid = 0;
+	const KeyVals& kvs = resolveKeys(frame_keys, &faid);
+	writeView("v@" + aidtostr(taid) + ":" + sid + ":", faid, kvs);
+}
+
+/// Bring the view records for `sid` in the view of frame `taid` up
+/// to date, after `sid` was written in the frame `fidc`. Mostly, only
+/// the records in `fidc` have to be looked at: if the Values visible
+/// in the view come from a frame above `fidc`, they stay visible; if
+/// they come from `fidc` or from underneath it, then those in `fidc`
+/// take their place. Only the `+` and `-` markers need all of the
+/// frames to be looked at. Must be called with the view lock for
+/// `sid` held.
+void RocksStorage::updateView(uint64_t taid, const FramePath& path,
+                              const std::string& fidc, const std::string& sid)
+{
+	std::string vid = "v@" + aidtostr(taid) + ":" + sid + ":";
+
+	// Which frame do the visible records come from, now?
+	uint64_t vaid = 0;
+	bool values = false;
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	it->Seek(vid);
+	if (it->Valid() and it->key().starts_with(vid))
+	{
+		const std::string& rks = it->key().ToString();
+		size_t colon = rks.find(':', vid.size());
+		vaid = strtoaid(rks.substr(vid.size(), colon - vid.size()));
+		values = ('+' != rks[colon+1] and '-' != rks[colon+1]);
+	}
+	delete it;
+
+	uint64_t faid = strtoaid(fidc.substr(0, fidc.size()-1));
+	if (values and faid < vaid) return;
+
+	// If nothing was visible, then `fidc` is the only frame holding
+	// records for `sid`.
+	if (0 == vaid or values)
+	{
+		KeyVals kvs;
+		std::string cid = keyPrefix(sid, fidc);
+		size_t kidoff = cid.size();
+		auto cfh = frameFamily(fidc, false);
+		if (cfh)
+		{
+			auto kt = _rfile->NewIterator(rocksdb::ReadOptions(), cfh);
+			for (kt->Seek(cid); kt->Valid() and kt->key().starts_with(cid); kt->Next())
+				kvs.push_back({kt->key().ToString().substr(kidoff),
+					kt->value().ToString()});
+			delete kt;
+		}
+
+		if (0 == vaid or
+		    (0 < kvs.size() and '+' != kvs[0].first[0] and '-' != kvs[0].first[0]))
+		{
+			writeView(vid, faid, kvs);
+			return;
+		}
+	}
+
+	refreshView(taid, path, sid);
+}
+
+/// Replace the view records at `vid` (which ends with the sid and a
+/// colon) with `kvs`, taken from the frame `faid`.
+void RocksStorage::writeView(const std::string& vid, uint64_t faid,
+                             const KeyVals& kvs)
+{
+	rocksdb::WriteBatch batch;
+	writeView(batch, vid, faid, kvs);
+	_rfile->Write(rocksdb::WriteOptions(), &batch);
+}
+
+/// Same as above, but add the writes to `batch`.
+void RocksStorage::writeView(rocksdb::WriteBatch& batch,
+                             const std::string& vid, uint64_t faid,
+                             const KeyVals& kvs)
+{
+	// Out with the old ...
+	batch.DeleteRange(vid, prefix_end(vid));
+
+	// ... and in with the new.
+	std::string vfid = vid + aidtostr(faid) + ":";
+	for (const auto& kv : kvs)
+		batch.Put(vfid + kv.first, kv.second);
+}
+
+/// Get the key-value pairs for the Atom at `sid` from the view at
+/// `vid`, and place them on `h`, in the frame they were copied from.
+/// That frame is looked up in `frame_order`, the path of `as`.
+void RocksStorage::getKeysView(AtomSpace* as, const FramePath& frame_order,
+                               const std::string& vid,
+                               const std::string& sid, const Handle& h)
+{
+	std::string cid = vid + sid + ":";
+	size_t fidoff = cid.size();
+
+	uint64_t faid = 0;
+	KeyVals kvs;
+	auto it = _rfile->NewIterator(rocksdb::ReadOptions());
+	for (it->Seek(cid); it->Valid() and it->key().starts_with(cid); it->Next())
+	{
+		const std::string& rks = it->key().ToString();
+		size_t colon = rks.find(':', fidoff);
+		faid = strtoaid(rks.substr(fidoff, colon - fidoff));
+		kvs.push_back({rks.substr(colon + 1), it->value().ToString()});
+	}
+	delete it;
+	if (0 == kvs.size()) return;
+
+	auto fit = frame_order.find(faid);
+	if (frame_order.end() != fit) as = (AtomSpace*) fit->second.get();
+
+	// Unlike getKeysMulti(), the lower frames are not loaded, so
+	// an Atom that is deleted in the view might not be in `as` at
+	// all. If so, there is nothing to hide.
+	if ('-' == kvs[0].first[0] and nullptr == as->get_atom(h)) return;
+
+	applyFrameKeys(as, kvs, h);
+}
+
+/// Delete the view of frame `fid`, if there is one.
+void RocksStorage::dropView(const std::string& fid)
+{
+	std::lock_guard<std::shared_mutex> lck(_mtx_view);
+	if (0 == _views.erase(strtoaid(fid))) return;
+
+	_rfile->Delete(rocksdb::WriteOptions(), "V@" + fid);
+
+	std::string vid = "v@" + fid + ":";
+	_rfile->DeleteRange(rocksdb::WriteOptions(), vid, prefix_end(vid));
+}
+
+// ======================================================================
+// User API
+
+/// Create a materialized view for the frame `as`. After this, Atom
+/// fetches into `as` will read from the view, instead of walking
+/// the frames under it. The view is kept up to date as Atoms are
+/// stored and deleted, and it persists until dropView() is called,
+/// or the frame is deleted.
+void RocksStorage::materializeView(AtomSpace* as)
+{
+	CHECK_OPEN;
+	if (not _multi_space)
+		throw IOException(TRACE_INFO, "There are no frames!");
+	if (not _frame_index)
+		throw IOException(TRACE_INFO, "DB too old to support views!");
+
+	Handle hasp = HandleCast(as);
+	const std::string& fid = findFrame(hasp);
+	if (0 == fid.size())
+		throw IOException(TRACE_INFO,
+			"The AtomSpace %s is not stored on disk!\n",
+			as->get_name().c_str());
+
+	FramePathPtr ppath = getPath(hasp);
+	const FramePath& path = *ppath;
+	uint64_t taid = strtoaid(fid);
+
+	// Register the view first, so that concurrent stores keep it
+	// up to date while it is being built.
+	{
+		std::lock_guard<std::shared_mutex> xlck(_mtx_view);
+		if (_views.end() != _views.find(taid)) return;
+		_views.emplace(taid, path);
+		_rfile->Put(rocksdb::WriteOptions(), "V@" + fid, "");
+	}
+	std::shared_lock<std::shared_mutex> lck(_mtx_view);
+	if (_views.end() == _views.find(taid)) return;
+
+	// Every Atom in every frame on the path.
+	std::vector<std::string> members;
+	for (const auto& frit : path)
+		getFrameMembers(aidtostr(frit.first) + ":", members);
+	std::unordered_set<std::string> sids(members.begin(), members.end());
+
+	for (const std::string& sid : sids)
+	{
+		std::lock_guard<std::mutex> slck(
+			_mtx_view_sids[std::hash<std::string>()(sid) % VIEW_LOCKS]);
+		refreshView(taid, path, sid);
+	}
+}
+
+/// Delete the materialized view for the frame `as`.
+void RocksStorage::dropView(AtomSpace* as)
+{
+	CHECK_OPEN;
+	if (not _multi_space) return;
+
+	const std::string& fid = findFrame(HandleCast(as));
+	if (0 == fid.size()) return;
+	dropView(fid);
+}
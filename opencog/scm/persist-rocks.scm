@@ -22,6 +22,16 @@
 (export cog-rocks-clear-stats cog-rocks-close cog-rocks-open
 cog-rocks-stats cog-rocks-get cog-rocks-print
 cog-rocks-check cog-rocks-scrub
+cog-rocks-sample cog-rocks-load-chunk
+cog-rocks-materialize-view cog-rocks-drop-view
+cog-rocks-squash cog-rocks-diff cog-rocks-count
+cog-rocks-incoming-size cog-rocks-incoming-size-by-type
+cog-rocks-declare-marginal cog-rocks-marginal
+cog-rocks-load-by-key cog-rocks-drop-key
+cog-rocks-declare-order cog-rocks-load-top
+cog-rocks-load-where cog-rocks-load-type-where
+cog-rocks-nodes-by-prefix cog-rocks-delete-type
+cog-rocks-remove-atoms
 )
 
 ; --------------------------------------------------------------
@@ -55,11 +65,32 @@ cog-rocks-check cog-rocks-scrub
    The URL must be of the form:
       rocks://path/to/file
 
+   optionally followed by `?column-families`. With this option, each
+   frame is kept in a RocksDB column family of its own, so that
+   deleting a frame is fast. Fetching Atoms through deep stacks of
+   frames gets slower. The option only has an effect when the file
+   does not yet hold any frames; after that, the file keeps whatever
+   layout it was created with.
+
+   The option `?merge-values` changes how `*-update-value-*` writes
+   numeric (FloatValue) deltas: only the delta is written, and RocksDB
+   adds it to the Value already on disk. Updates made by several
+   processes sharing the same file are then not lost.
+
+   The option `?key-index` keeps an index of which Atoms have Values
+   at which keys, for use by `cog-rocks-load-by-key`. The index is
+   built the first time the option is given; after that, it is kept
+   up to date, whether or not the option is given again.
+
+   Options can be combined, as in `?column-families&merge-values`.
+
    This will create a RocksStorageNode holding the URL, and place it
    in the current AtomSpace.
 
    Examples of use with valid URL's:
       (cog-rocks-open \"rocks://var/local/opencog/data/rocks.db\")
+      (cog-rocks-open \"rocks:///tmp/frames.rdb?column-families\")
+      (cog-rocks-open \"rocks:///tmp/counts.rdb?merge-values\")
 ")
 
 (set-procedure-property! cog-rocks-stats 'documentation
@@ -109,3 +140,368 @@ cog-rocks-check cog-rocks-scrub
     After frame deletions, the database might contain records of Atoms
     that are not in any frame. This function will delete them.
 ")
+
+(set-procedure-property! cog-rocks-sample 'documentation
+"
+ cog-rocks-sample RSN TYPE N SEED - Load a random sample of Atoms.
+
+    RSN must be a RocksStorageNode, and it must be open.
+    TYPE must be an Atom type, for example 'EdgeLink.
+    N is the number of Atoms to sample.
+    SEED is an integer seed for the random number generator.
+
+    Load a uniformly-distributed random sample of N Atoms of type TYPE,
+    together with all of their Values, into the current AtomSpace.
+    Nothing else is loaded. The sample is drawn without replacement;
+    if fewer than N such Atoms are stored, all of them are loaded.
+    The same SEED always gives the same sample, provided that the
+    database has not changed. Returns a list of the sampled Atoms.
+
+    Example:
+       (cog-rocks-sample (RocksStorageNode \"rocks:///tmp/foo.rdb\")
+           'EdgeLink 10000 42)
+")
+
+(set-procedure-property! cog-rocks-load-chunk 'documentation
+"
+ cog-rocks-load-chunk RSN CURSOR N - Load part of the AtomSpace.
+
+    RSN must be a RocksStorageNode, and it must be open.
+    CURSOR is a string; use the empty string \"\" to start a new load.
+    N is the maximum number of Atoms to load; it must be positive.
+
+    Load up to N Atoms, together with their Values, into the current
+    AtomSpace, and return the cursor at which the next chunk starts.
+    When everything has been loaded, the empty string is returned.
+    Repeated calls load exactly the same Atoms as `load-atomspace`
+    does. The cursor is an ordinary string; it can be saved, and used
+    to resume the load later, after a restart.
+
+    Example:
+       (define (load-all RSN)
+          (let loop ((cursor \"\"))
+             (define next (cog-rocks-load-chunk RSN cursor 100000))
+             (if (not (string-null? next)) (loop next))))
+")
+
+(set-procedure-property! cog-rocks-materialize-view 'documentation
+"
+ cog-rocks-materialize-view RSN - Keep a resolved view of this frame.
+
+    RSN must be a RocksStorageNode, and it must be open. The current
+    AtomSpace must be a frame that has been stored.
+
+    Fetching an Atom into a frame normally means walking through all
+    of the frames underneath it, to find out which Values are visible.
+    This is slow, when there are thousands of frames. This creates a
+    copy of the visible Values, for every Atom in the current frame;
+    after this, fetches into this frame read only that copy. The copy
+    is updated whenever Atoms are stored into, or removed from, any
+    frame underneath, so stores get slower. The view is kept in the
+    database until it is dropped, or the frame is deleted.
+
+    See also: `cog-rocks-drop-view`.
+")
+
+(set-procedure-property! cog-rocks-drop-view 'documentation
+"
+ cog-rocks-drop-view RSN - Remove the resolved view of this frame.
+
+    RSN must be a RocksStorageNode, and it must be open. Remove the
+    view of the current AtomSpace created by `cog-rocks-materialize-view`.
+    Fetches into this frame will walk the frames underneath it again.
+")
+
+(set-procedure-property! cog-rocks-squash 'documentation
+"
+ cog-rocks-squash RSN DEPTH - Merge frames into one.
+
+    RSN must be a RocksStorageNode, and it must be open. The current
+    AtomSpace must be a frame that has been stored.
+
+    Merge the current frame, and the DEPTH frames underneath it, into
+    a single frame. Only the Values visible from the current frame are
+    kept; all of the older Values that they hide are deleted. The new
+    frame has the name of the current frame, and sits on whatever the
+    lowest merged frame sat on. Fetches from the merged frame no longer
+    need to walk through all of the older frames.
+
+    The merged frames must form a simple stack; none of them, except
+    the current frame, can have any other frames on top of them.
+
+    After this, the AtomSpaces that were merged are no longer valid;
+    storing or fetching through them, or through the old current frame,
+    throws an error. The frames must be loaded again, with `load-frames`.
+
+    Atoms that appeared only in the deleted history are left behind
+    in the database. They can be removed with `cog-rocks-scrub`.
+")
+
+(set-procedure-property! cog-rocks-diff 'documentation
+"
+ cog-rocks-diff RSN A B - Compare two stored frames.
+
+    RSN must be a RocksStorageNode, and it must be open. A and B must
+    be AtomSpaces (frames) that have been stored.
+
+    Compare the Atoms that would be seen after loading frame A, to
+    those that would be seen after loading frame B, without loading
+    either one. Returns a LinkValue holding three LinkValues: the Atoms
+    visible in B but not in A, the Atoms visible in A but not in B,
+    and the Atoms visible in both, but having different Values. The
+    Atoms are not placed in any AtomSpace.
+
+    Only the frames that are underneath one of A or B, but not both,
+    are looked at, so that comparing two frames near the top of a
+    deep stack is fast.
+
+    Example:
+       (cog-value->list (cog-rocks-diff RSN episode-1 episode-2))
+")
+
+(set-procedure-property! cog-rocks-count 'documentation
+"
+ cog-rocks-count RSN TYPE - Count the stored Atoms of type TYPE.
+
+    RSN must be a RocksStorageNode, and it must be open.
+    TYPE must be an Atom type, for example 'EdgeLink.
+
+    Return the number of Atoms of exactly the type TYPE (subtypes are
+    not counted) that are held in the database, in any frame. Nothing
+    is loaded. The count is kept up to date as Atoms are stored and
+    removed, so this is fast, even for very large databases.
+
+    Example:
+       (cog-rocks-count (RocksStorageNode \"rocks:///tmp/foo.rdb\")
+           'EdgeLink)
+")
+
+(set-procedure-property! cog-rocks-incoming-size 'documentation
+"
+ cog-rocks-incoming-size RSN ATOM - Size of the stored incoming set.
+
+    RSN must be a RocksStorageNode, and it must be open.
+
+    Return the number of Links in the database that hold ATOM, without
+    loading any of them. This is a single lookup, no matter how large
+    the incoming set is. Links in all frames are counted.
+
+    See also: `cog-rocks-incoming-size-by-type`, `fetch-incoming-set`.
+")
+
+(set-procedure-property! cog-rocks-incoming-size-by-type 'documentation
+"
+ cog-rocks-incoming-size-by-type RSN ATOM TYPE - Size of the stored
+    incoming set, of the given type.
+
+    RSN must be a RocksStorageNode, and it must be open.
+    TYPE must be a Link type, for example 'EdgeLink.
+
+    Return the number of Links of exactly type TYPE in the database
+    that hold ATOM, without loading any of them.
+
+    See also: `cog-rocks-incoming-size`, `fetch-incoming-by-type`.
+")
+
+(set-procedure-property! cog-rocks-declare-marginal 'documentation
+"
+ cog-rocks-declare-marginal RSN TYPE KEY - Keep sums over incoming sets.
+
+    RSN must be a RocksStorageNode, and it must be open.
+    TYPE must be a Link type, for example 'EdgeLink.
+    KEY is the key of the Values to add up.
+
+    From now on, for every Atom, keep the sum of the FloatValues at KEY
+    on all of the Links of type TYPE that hold that Atom, separately for
+    each position in the outgoing set. The sums are updated as Values
+    are stored and updated, and as Links are removed, so that they can
+    be read with `cog-rocks-marginal` without fetching anything else.
+    The sums over the Links that are already stored are computed now.
+    The declaration is kept in the database.
+
+    Marginals are not available for databases holding frames.
+
+    Example:
+       (cog-rocks-declare-marginal RSN 'EdgeLink (Predicate \"count\"))
+")
+
+(set-procedure-property! cog-rocks-marginal 'documentation
+"
+ cog-rocks-marginal RSN ATOM TYPE KEY POS - Get a sum over an incoming set.
+
+    RSN must be a RocksStorageNode, and it must be open. A marginal
+    for TYPE and KEY must have been declared with
+    `cog-rocks-declare-marginal`.
+
+    Return a FloatValue holding the sum of the Values at KEY, over all
+    of the Links of type TYPE that hold ATOM at position POS in their
+    outgoing set. Positions count from zero. Returns an empty FloatValue
+    if there are no such Links.
+
+    Example:
+       ; The sum of the counts on all (Edge (Predicate \"p\") (List ...))
+       (cog-rocks-marginal RSN (Predicate \"p\") 'EdgeLink
+           (Predicate \"count\") 0)
+")
+
+(set-procedure-property! cog-rocks-load-by-key 'documentation
+"
+ cog-rocks-load-by-key RSN KEY - Load the Atoms having a Value at KEY.
+
+    RSN must be a RocksStorageNode, and it must be open.
+
+    Load all of the Atoms that have a Value at KEY, together with all
+    of their Values, into the current AtomSpace. With frames, only the
+    Atoms whose Value at KEY is visible from the current AtomSpace are
+    loaded. Returns a list of the loaded Atoms.
+
+    This is fast if the database was opened with the `?key-index`
+    option (see `cog-rocks-open`). Otherwise, all of the Values in the
+    database are scanned.
+
+    Example:
+       (cog-rocks-load-by-key RSN (Predicate \"interesting\"))
+")
+
+(set-procedure-property! cog-rocks-drop-key 'documentation
+"
+ cog-rocks-drop-key RSN KEY - Delete all Values at KEY from storage.
+
+    RSN must be a RocksStorageNode, and it must be open.
+
+    Delete the Values at KEY from every Atom in the database, in every
+    frame. The Atoms themselves are not deleted. Nothing is changed in
+    any AtomSpace.
+")
+
+(set-procedure-property! cog-rocks-declare-order 'documentation
+"
+ cog-rocks-declare-order RSN KEY INDEX - Keep Atoms sorted by a number.
+
+    RSN must be a RocksStorageNode, and it must be open.
+    KEY is the key of FloatValues holding the number.
+    INDEX is the location of the number in the FloatValue, counting
+    from zero.
+
+    From now on, keep an index of all of the Atoms having a FloatValue
+    at KEY, sorted by the number at INDEX in that FloatValue. The Atoms
+    that are already stored are indexed now. The declaration is kept
+    in the database. Use `cog-rocks-load-top` to load the Atoms having
+    the largest numbers.
+
+    Ordered indexes are not available for databases holding frames.
+
+    Example:
+       ; Sort by the count, the third number in the Value.
+       (cog-rocks-declare-order RSN (Predicate \"counts\") 2)
+")
+
+(set-procedure-property! cog-rocks-load-top 'documentation
+"
+ cog-rocks-load-top RSN KEY INDEX N - Load the Atoms with the largest
+    numbers.
+
+    RSN must be a RocksStorageNode, and it must be open. An index for
+    KEY and INDEX must have been declared with `cog-rocks-declare-order`.
+
+    Load the N Atoms having the largest numbers at INDEX in their
+    FloatValues at KEY, together with all of their Values, into the
+    current AtomSpace. Nothing else is loaded. Returns a list of the
+    Atoms, largest first.
+
+    Example:
+       (cog-rocks-load-top RSN (Predicate \"counts\") 2 100)
+")
+
+(set-procedure-property! cog-rocks-load-where 'documentation
+"
+ cog-rocks-load-where RSN KEY INDEX MIN - Load the Atoms having a
+    number at least as large as MIN.
+
+    RSN must be a RocksStorageNode, and it must be open.
+
+    Load all of the Atoms having a FloatValue at KEY, in which the
+    number at INDEX is MIN or larger, together with all of their
+    Values, into the current AtomSpace. The test is made on the Values
+    in storage; Atoms that fail it are not loaded. Returns a list of
+    the Atoms that were loaded.
+
+    This is much faster if the database was opened with the
+    `key-index` option; see `cog-rocks-load-by-key`.
+
+    Example:
+       ; Load everything seen at least five times.
+       (cog-rocks-load-where RSN (Predicate \"counts\") 2 5)
+")
+
+(set-procedure-property! cog-rocks-load-type-where 'documentation
+"
+ cog-rocks-load-type-where RSN TYPE KEY INDEX MIN - Load the Atoms of
+    type TYPE having a number at least as large as MIN.
+
+    Same as `cog-rocks-load-where`, except that only Atoms of type
+    TYPE are loaded.
+
+    Example:
+       (cog-rocks-load-type-where RSN 'EdgeLink (Predicate \"counts\") 2 5)
+")
+
+(set-procedure-property! cog-rocks-nodes-by-prefix 'documentation
+"
+ cog-rocks-nodes-by-prefix RSN TYPE PREFIX LIMIT - Load the Nodes
+    whose names start with PREFIX.
+
+    RSN must be a RocksStorageNode, and it must be open. TYPE must be
+    a Node type.
+
+    Load up to LIMIT Nodes of type TYPE, whose names start with the
+    string PREFIX, together with their Values, into the current
+    AtomSpace. Only these Nodes are read from storage; this is fast
+    even when there are many Nodes of that type. Returns a list of
+    the Nodes, sorted by name.
+
+    Example:
+       (cog-rocks-nodes-by-prefix RSN 'WordNode \"aard\" 10)
+")
+
+(set-procedure-property! cog-rocks-delete-type 'documentation
+"
+ cog-rocks-delete-type RSN TYPE RECURSIVE - Delete all Atoms of type
+    TYPE from storage.
+
+    RSN must be a RocksStorageNode, and it must be open.
+
+    Delete every Atom of exactly the type TYPE (not its subtypes) from
+    storage, together with its Values. If RECURSIVE is #t, then the
+    Links holding these Atoms are deleted too; otherwise, the Atoms
+    that have an incoming set are kept. Atoms that are in use as keys
+    or messages are kept. Returns the number of Atoms deleted.
+
+    This is much faster than deleting the Atoms one at a time. It
+    does not touch the AtomSpace. It should not be used while other
+    threads are writing, and is not available for databases holding
+    frames.
+
+    Example:
+       (cog-rocks-delete-type RSN 'EvaluationLink #f)
+")
+
+(set-procedure-property! cog-rocks-remove-atoms 'documentation
+"
+ cog-rocks-remove-atoms RSN ATOM-LIST RECURSIVE - Remove many Atoms
+    from storage at once.
+
+    RSN must be a RocksStorageNode, and it must be open.
+
+    Remove all of the Atoms in ATOM-LIST from storage. If RECURSIVE
+    is #t, then everything holding them is removed too; otherwise,
+    Atoms held by Links that are not being removed are kept. Atoms
+    that are in use as keys or messages are kept. For databases
+    without frames, this is done with a single atomic write.
+
+    This removes the Atoms from storage only; it does not touch the
+    current AtomSpace.
+
+    Example:
+       (cog-rocks-remove-atoms RSN (cog-get-atoms 'EdgeLink) #f)
+")
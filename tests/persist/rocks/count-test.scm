@@ -0,0 +1,52 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; count-test.scm
+; Verify that the stored Atoms can be counted by type.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-count-test")
+
+(opencog-test-runner)
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-count-test"))
+
+; -------------------------------------------------------------------
+(define count-test "test counts")
+(test-begin count-test)
+
+(cog-open storage)
+(store-atom (Edge (Predicate "p") (List (Concept "a") (Concept "b"))))
+(store-atom (Edge (Predicate "p") (List (Concept "b") (Concept "c"))))
+(store-atom (Concept "d"))
+(store-atom (set-cnt! (Concept "a") (FloatValue 1 0 3)))
+
+(test-equal "concepts" 4 (cog-rocks-count storage 'Concept))
+(test-equal "edges" 2 (cog-rocks-count storage 'Edge))
+(test-equal "lists" 2 (cog-rocks-count storage 'List))
+(test-equal "preds" 1 (cog-rocks-count storage 'Predicate))
+(test-equal "numbers" 0 (cog-rocks-count storage 'NumberNode))
+
+; Removal is counted too.
+(cog-delete-recursive! (Concept "c"))
+(test-equal "less concepts" 3 (cog-rocks-count storage 'Concept))
+(test-equal "less edges" 1 (cog-rocks-count storage 'Edge))
+(test-equal "less lists" 1 (cog-rocks-count storage 'List))
+(cog-close storage)
+
+; The counts survive a re-open.
+(cog-atomspace-clear)
+(cog-open storage)
+(test-equal "reopen concepts" 3 (cog-rocks-count storage 'Concept))
+(test-equal "reopen edges" 1 (cog-rocks-count storage 'Edge))
+(cog-close storage)
+
+(test-end count-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-count-test")
+(opencog-test-end)
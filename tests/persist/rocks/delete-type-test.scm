@@ -0,0 +1,71 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; delete-type-test.scm
+; Verify that all Atoms of a type can be deleted at once.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-delete-type-test")
+
+(opencog-test-runner)
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-delete-type-test"))
+
+; -------------------------------------------------------------------
+(define delete-type-test "test delete type")
+(test-begin delete-type-test)
+
+(cog-open storage)
+(store-atom (set-cnt! (Edge (Predicate "p") (List (Concept "a") (Concept "b")))
+	(FloatValue 1 0 3)))
+(store-atom (Edge (Predicate "p") (List (Concept "b") (Concept "c"))))
+(store-atom (Evaluation (Predicate "q") (Concept "a")))
+(store-atom (set-cnt! (Concept "d") (FloatValue 1 0 4)))
+
+; Not recursive: only the Concepts with no incoming set go.
+(test-equal "lone concept" 1 (cog-rocks-delete-type storage 'ConceptNode #f))
+(test-equal "concepts left" 3 (cog-rocks-count storage 'Concept))
+
+; The Edges hold nothing up; the Lists lose their incoming sets.
+(test-equal "edges" 2 (cog-rocks-delete-type storage 'EdgeLink #f))
+(test-equal "no edges" 0 (cog-rocks-count storage 'Edge))
+(test-equal "lists kept" 2 (cog-rocks-count storage 'List))
+(test-equal "list inset" 0
+	(cog-rocks-incoming-size storage (List (Concept "a") (Concept "b"))))
+(test-equal "pred inset" 0 (cog-rocks-incoming-size storage (Predicate "p")))
+(test-equal "q inset" 1 (cog-rocks-incoming-size storage (Predicate "q")))
+(cog-close storage)
+
+(cog-atomspace-clear)
+(cog-open storage)
+(load-atomspace)
+(test-equal "loaded edges" 0 (cog-count-atoms 'EdgeLink))
+(test-equal "loaded lists" 2 (cog-count-atoms 'ListLink))
+(test-equal "loaded concepts" 3 (cog-count-atoms 'ConceptNode))
+
+; Recursive: the Lists and the Evaluation go with the Concepts.
+(cog-atomspace-clear)
+(test-equal "recursive" 3 (cog-rocks-delete-type storage 'ConceptNode #t))
+(test-equal "no concepts" 0 (cog-rocks-count storage 'Concept))
+(test-equal "no lists" 0 (cog-rocks-count storage 'List))
+(test-equal "no evals" 0 (cog-rocks-count storage 'Evaluation))
+(test-equal "q no inset" 0 (cog-rocks-incoming-size storage (Predicate "q")))
+(cog-close storage)
+
+(cog-atomspace-clear)
+(cog-open storage)
+(load-atomspace)
+(test-equal "all gone" 0 (cog-count-atoms 'ConceptNode))
+; Two, plus the key holding the counts.
+(test-equal "preds kept" 3 (cog-count-atoms 'PredicateNode))
+(cog-close storage)
+
+(test-end delete-type-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-delete-type-test")
+(opencog-test-end)
@@ -0,0 +1,93 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; diff-test.scm
+; Verify that two stored frames can be compared without loading them.
+;
+(use-modules (srfi srfi-1))
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-diff-test")
+
+(opencog-test-runner)
+
+; -------------------------------------------------------------------
+; Two episodes, sitting on a common base.
+
+(define base-space (cog-atomspace))
+(define ep1-space (AtomSpace "ep1" base-space))
+(define ep2-space (AtomSpace "ep2" base-space))
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-diff-test"))
+
+(define (setup-and-store)
+	(cog-open storage)
+	(cog-set-value! storage (*-store-frames-*) ep1-space)
+	(cog-set-value! storage (*-store-frames-*) ep2-space)
+
+	(cog-set-atomspace! base-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 3)))
+	(store-atom (set-cnt! (Concept "bar") (FloatValue 1 0 4)))
+	(store-atom (set-cnt! (Concept "baz") (FloatValue 1 0 5)))
+
+	(cog-set-atomspace! ep1-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 7)))
+	(cog-delete! (Concept "bar"))
+
+	(cog-set-atomspace! ep2-space)
+	(store-atom (set-cnt! (Concept "baz") (FloatValue 1 0 6)))
+	(store-atom (Concept "qux"))
+
+	(cog-set-atomspace! base-space)
+)
+
+; Return the added, removed and changed Atoms as three lists.
+(define (diff A B)
+	(map cog-value->list
+		(cog-value->list (cog-rocks-diff storage A B))))
+
+(define (same-set? LA LB)
+	(and (= (length LA) (length LB))
+		(every (lambda (a) (member a LB)) LA)))
+
+; -------------------------------------------------------------------
+
+(define (test-diff)
+	(setup-and-store)
+
+	(define fwd (diff ep1-space ep2-space))
+	(test-assert "added" (same-set? (first fwd)
+		(list (Concept "bar") (Concept "qux"))))
+	(test-assert "removed" (null? (second fwd)))
+	(test-assert "changed" (same-set? (third fwd)
+		(list (Concept "foo") (Concept "baz"))))
+
+	(define rev (diff ep2-space ep1-space))
+	(test-assert "rev-added" (null? (first rev)))
+	(test-assert "rev-removed" (same-set? (second rev)
+		(list (Concept "bar") (Concept "qux"))))
+	(test-assert "rev-changed" (same-set? (third rev)
+		(list (Concept "foo") (Concept "baz"))))
+
+	; A frame does not differ from itself.
+	(test-assert "self" (every null? (diff ep1-space ep1-space)))
+
+	; Relative to the base, only ep2 adds anything.
+	(define up (diff base-space ep2-space))
+	(test-assert "up-added" (same-set? (first up) (list (Concept "qux"))))
+	(test-assert "up-changed" (same-set? (third up) (list (Concept "baz"))))
+
+	(cog-close storage)
+)
+
+(define diff-test "test frame diff")
+(test-begin diff-test)
+(test-diff)
+(test-end diff-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-diff-test")
+(opencog-test-end)
@@ -0,0 +1,93 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; family-test.scm
+; Verify that frames kept in column families can be stored, loaded
+; and deleted.
+;
+(use-modules (srfi srfi-1))
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-family-test")
+
+(opencog-test-runner)
+
+(define family-uri "rocks:///tmp/cog-rocks-family-test?column-families")
+
+; -------------------------------------------------------------------
+; Common setup, used by all tests.
+
+(define (setup-and-store)
+	(define base-space (cog-atomspace))
+	(define mid-space (AtomSpace base-space))
+	(define top-space (AtomSpace mid-space))
+
+	(define storage (RocksStorageNode family-uri))
+	(cog-open storage)
+	(cog-set-value! storage (*-store-frames-*) top-space)
+
+	(cog-set-atomspace! base-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 3)))
+	(store-atom (set-cnt! (Concept "bar") (FloatValue 1 0 4)))
+
+	(cog-set-atomspace! mid-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 5)))
+	(cog-delete! (Concept "bar"))
+
+	(cog-set-atomspace! top-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 7)))
+	(store-atom (Concept "keyless"))
+
+	(cog-close storage)
+	(cog-set-atomspace! base-space)
+)
+
+; -------------------------------------------------------------------
+; Load the frames, and then delete the top one.
+
+(define (test-family)
+	(setup-and-store)
+
+	(cog-set-atomspace! (AtomSpace))
+	(define storage (RocksStorageNode family-uri))
+	(cog-open storage)
+	(define top-space (cog-value-ref (cog-value storage (*-load-frames-*)) 0))
+	(cog-set-atomspace! top-space)
+	(cog-set-value! storage (*-load-atomspace-*) (cog-atomspace))
+
+	(test-equal "foo" 7 (get-cnt (cog-node 'Concept "foo")))
+	(test-equal "bar" #f (cog-node 'Concept "bar"))
+	(test-assert "keyless" (cog-node 'Concept "keyless"))
+
+	(cog-set-value! storage (*-delete-frame-*) top-space)
+	(cog-close storage)
+
+	; Reopen, without the URI option. The layout is remembered.
+	(cog-set-atomspace! (AtomSpace))
+	(define restore (RocksStorageNode "rocks:///tmp/cog-rocks-family-test"))
+	(cog-open restore)
+	(define mid-space (cog-value-ref (cog-value restore (*-load-frames-*)) 0))
+	(cog-set-atomspace! mid-space)
+	(cog-set-value! restore (*-load-atomspace-*) (cog-atomspace))
+	(cog-close restore)
+
+	(test-equal "mid-foo" 5 (get-cnt (cog-node 'Concept "foo")))
+	(test-equal "mid-bar" #f (cog-node 'Concept "bar"))
+	(test-equal "mid-keyless" #f (cog-node 'Concept "keyless"))
+
+	(cog-set-atomspace! (cog-outgoing-atom mid-space 0))
+	(test-equal "base-foo" 3 (get-cnt (cog-node 'Concept "foo")))
+	(test-equal "base-bar" 4 (get-cnt (cog-node 'Concept "bar")))
+)
+
+(define family-test "test column families")
+(test-begin family-test)
+(test-family)
+(test-end family-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-family-test")
+(opencog-test-end)
@@ -0,0 +1,56 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; incoming-size-test.scm
+; Verify that the size of the stored incoming set can be found,
+; without loading it.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-incoming-size-test")
+
+(opencog-test-runner)
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-incoming-size-test"))
+
+; -------------------------------------------------------------------
+(define incoming-test "test incoming size")
+(test-begin incoming-test)
+
+(cog-open storage)
+(store-atom (Edge (Predicate "p") (List (Concept "hub") (Concept "a"))))
+(store-atom (Edge (Predicate "p") (List (Concept "hub") (Concept "b"))))
+(store-atom (Edge (Predicate "p") (List (Concept "hub") (Concept "c"))))
+(store-atom (Set (Concept "hub") (Concept "a")))
+(store-atom (List (Concept "hub") (Concept "hub")))
+(cog-close storage)
+
+; Nothing is loaded.
+(cog-atomspace-clear)
+(cog-open storage)
+(test-equal "hub" 5 (cog-rocks-incoming-size storage (Concept "hub")))
+(test-equal "hub lists" 4
+	(cog-rocks-incoming-size-by-type storage (Concept "hub") 'List))
+(test-equal "hub sets" 1
+	(cog-rocks-incoming-size-by-type storage (Concept "hub") 'Set))
+(test-equal "hub edges" 0
+	(cog-rocks-incoming-size-by-type storage (Concept "hub") 'Edge))
+(test-equal "a" 2 (cog-rocks-incoming-size storage (Concept "a")))
+(test-equal "pred" 3 (cog-rocks-incoming-size storage (Predicate "p")))
+(test-equal "unknown" 0 (cog-rocks-incoming-size storage (Concept "zzz")))
+(test-equal "no load" 0 (length (cog-incoming-set (Concept "hub"))))
+
+; Removal shrinks the incoming set.
+(cog-delete-recursive! (Concept "b"))
+(test-equal "less hub" 4 (cog-rocks-incoming-size storage (Concept "hub")))
+(test-equal "less pred" 2 (cog-rocks-incoming-size storage (Predicate "p")))
+(cog-close storage)
+
+(test-end incoming-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-incoming-size-test")
+(opencog-test-end)
@@ -0,0 +1,78 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; key-index-test.scm
+; Verify that the Atoms having a Value at some key can be loaded,
+; without loading anything else.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-key-index-test")
+(whack "/tmp/cog-rocks-key-scan-test")
+
+(opencog-test-runner)
+
+(define tag (Predicate "tag"))
+
+(define (setup-and-store URL)
+	(define storage (RocksStorageNode URL))
+	(cog-open storage)
+	(store-atom (set-cnt! (Concept "a") (FloatValue 1 0 3)))
+	(store-atom (set-cnt! (Concept "b") (FloatValue 1 0 4)))
+	(store-atom (set-cnt! (Concept "c") (FloatValue 1 0 5)))
+	(store-atom (cog-set-value! (Concept "a") tag (FloatValue 1)))
+	(store-atom (cog-set-value! (Concept "c") tag (FloatValue 2)))
+	(cog-close storage)
+	(cog-atomspace-clear))
+
+(define (test-load URL)
+	(define storage (RocksStorageNode URL))
+	(cog-open storage)
+	(define loaded (cog-rocks-load-by-key storage tag))
+	(test-equal "loaded" 2 (length loaded))
+	(test-assert "has a" (member (Concept "a") loaded))
+	(test-assert "has c" (member (Concept "c") loaded))
+	(test-equal "a count" 3 (get-cnt (Concept "a")))
+	(test-equal "c tag" (FloatValue 2) (cog-value (Concept "c") tag))
+	(test-equal "no b" 2 (cog-count-atoms 'ConceptNode))
+
+	; Drop the key; nothing is found any more.
+	(cog-rocks-drop-key storage tag)
+	(cog-close storage)
+	(cog-atomspace-clear)
+
+	(set! storage (RocksStorageNode URL))
+	(cog-open storage)
+	(test-equal "dropped" 0 (length (cog-rocks-load-by-key storage tag)))
+	(fetch-atom (Concept "a"))
+	(test-equal "a kept" 3 (get-cnt (Concept "a")))
+	(test-equal "a no tag" #f (cog-value (Concept "a") tag))
+	(cog-close storage)
+	(cog-atomspace-clear))
+
+; -------------------------------------------------------------------
+(define key-index-test "test key index")
+(test-begin key-index-test)
+
+(setup-and-store "rocks:///tmp/cog-rocks-key-index-test?key-index")
+(test-load "rocks:///tmp/cog-rocks-key-index-test?key-index")
+
+(test-end key-index-test)
+
+; -------------------------------------------------------------------
+; Without the index, the keys are scanned.
+(define key-scan-test "test key scan")
+(test-begin key-scan-test)
+
+(setup-and-store "rocks:///tmp/cog-rocks-key-scan-test")
+(test-load "rocks:///tmp/cog-rocks-key-scan-test")
+
+(test-end key-scan-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-key-index-test")
+(whack "/tmp/cog-rocks-key-scan-test")
+(opencog-test-end)
@@ -0,0 +1,82 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; load-chunk-test.scm
+; Verify that the AtomSpace can be loaded in chunks, and resumed.
+;
+(use-modules (srfi srfi-1))
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-load-chunk-test")
+
+(opencog-test-runner)
+
+; -------------------------------------------------------------------
+; Common setup, used by all tests.
+
+(define (setup-and-store)
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-load-chunk-test"))
+	(cog-open storage)
+
+	; Store 50 Concepts and 50 Lists, each with a count on it.
+	(for-each
+		(lambda (n)
+			(define con (Concept (format #f "thing ~A" n)))
+			(define lst (List con (Concept "other")))
+			(set-cnt! con (FloatValue 1 0 n))
+			(set-cnt! lst (FloatValue 1 0 (+ n 1000)))
+			(store-atom con)
+			(store-atom lst))
+		(iota 50))
+	(cog-close storage)
+)
+
+; -------------------------------------------------------------------
+; Load in small chunks, and verify that everything arrives.
+
+(define (test-load-chunks)
+	(setup-and-store)
+
+	; Start with a blank slate.
+	(cog-set-atomspace! (AtomSpace))
+
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-load-chunk-test"))
+	(cog-open storage)
+
+	; A zero-sized chunk would never make progress.
+	(test-assert "zero-budget"
+		(catch #t
+			(lambda () (cog-rocks-load-chunk storage "" 0) #f)
+			(lambda (key . args) #t)))
+
+	; The first chunk is partial.
+	(define cursor (cog-rocks-load-chunk storage "" 7))
+	(test-assert "partial" (not (string-null? cursor)))
+	(test-assert "few-lists" (> 50 (length (cog-get-atoms 'ListLink))))
+
+	; Finish it off.
+	(define nchunks
+		(let loop ((cur cursor) (cnt 1))
+			(if (string-null? cur) cnt
+				(loop (cog-rocks-load-chunk storage cur 7) (+ cnt 1)))))
+	(cog-close storage)
+
+	(test-assert "many-chunks" (< 10 nchunks))
+	(test-equal "list-count" 50 (length (cog-get-atoms 'ListLink)))
+	(test-equal "concept-count" 51 (length (cog-get-atoms 'ConceptNode)))
+	(test-equal "list-tv" 1042
+		(get-cnt (List (Concept "thing 42") (Concept "other"))))
+	(test-equal "concept-tv" 42 (get-cnt (Concept "thing 42")))
+)
+
+(define load-chunks "test load-chunks")
+(test-begin load-chunks)
+(test-load-chunks)
+(test-end load-chunks)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-load-chunk-test")
+(opencog-test-end)
@@ -0,0 +1,80 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; load-where-test.scm
+; Verify that only the Atoms with large enough counts are loaded,
+; both with and without the key index.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-where-test")
+(whack "/tmp/cog-rocks-where-index-test")
+
+(opencog-test-runner)
+
+(define (store-cnt ATOM CNT)
+	(store-atom (set-cnt! ATOM (FloatValue 1 0 CNT))))
+
+(define (setup-and-store URL)
+	(define storage (RocksStorageNode URL))
+	(cog-open storage)
+	(store-cnt (Concept "a") 3)
+	(store-cnt (Concept "b") 7)
+	(store-cnt (Concept "c") 5)
+	(store-cnt (Edge (Predicate "p") (List (Concept "a") (Concept "b"))) 9)
+	(store-cnt (Edge (Predicate "p") (List (Concept "b") (Concept "c"))) 1)
+	(store-atom (Concept "no count"))
+	(cog-close storage)
+	(cog-atomspace-clear))
+
+(define (test-where URL)
+	(define storage (RocksStorageNode URL))
+	(cog-open storage)
+
+	; Only the Edge with the large count; its outgoing set comes along.
+	(define edges (cog-rocks-load-type-where storage 'EdgeLink pk 2 5))
+	(test-equal "one edge" 1 (length edges))
+	(test-equal "edge count" 9 (get-cnt (car edges)))
+	(test-equal "edges loaded" 1 (cog-count-atoms 'EdgeLink))
+	(test-equal "concepts not loaded" 2 (cog-count-atoms 'ConceptNode))
+
+	(cog-atomspace-clear)
+	(cog-open storage)
+	(define cpts (cog-rocks-load-type-where storage 'ConceptNode pk 2 5))
+	(test-equal "two concepts" 2 (length cpts))
+	(test-equal "b count" 7 (get-cnt (Concept "b")))
+	(test-equal "c count" 5 (get-cnt (Concept "c")))
+	(test-equal "only two" 2 (cog-count-atoms 'ConceptNode))
+
+	(cog-atomspace-clear)
+	(cog-open storage)
+	(define all (cog-rocks-load-where storage pk 2 5))
+	(test-equal "all types" 3 (length all))
+	(test-equal "no small edge" 1 (cog-count-atoms 'EdgeLink))
+
+	(cog-atomspace-clear)
+	(cog-open storage)
+	(test-equal "none" '() (cog-rocks-load-where storage pk 2 100))
+	(test-equal "nothing loaded" 0 (cog-count-atoms 'ConceptNode))
+	(cog-close storage)
+	(cog-atomspace-clear))
+
+; -------------------------------------------------------------------
+(define where-test "test load where")
+(test-begin where-test)
+
+(setup-and-store "rocks:///tmp/cog-rocks-where-test")
+(test-where "rocks:///tmp/cog-rocks-where-test")
+
+(setup-and-store "rocks:///tmp/cog-rocks-where-index-test?key-index")
+(test-where "rocks:///tmp/cog-rocks-where-index-test")
+
+(test-end where-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-where-test")
+(whack "/tmp/cog-rocks-where-index-test")
+(opencog-test-end)
@@ -0,0 +1,63 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; marginal-test.scm
+; Verify that sums of Values over incoming sets are kept up to date.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-marginal-test")
+
+(opencog-test-runner)
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-marginal-test"))
+
+(define (edge A B) (Edge (Predicate "p") (List (Concept A) (Concept B))))
+(define (pred-marginal)
+	(cog-rocks-marginal storage (Predicate "p") 'Edge pk 0))
+
+; -------------------------------------------------------------------
+(define marginal-test "test marginals")
+(test-begin marginal-test)
+
+(cog-open storage)
+(store-atom (set-cnt! (edge "a" "b") (FloatValue 1 0 3)))
+(store-atom (set-cnt! (edge "a" "c") (FloatValue 1 0 4)))
+
+; Links stored before the declaration are counted.
+(cog-rocks-declare-marginal storage 'Edge pk)
+(test-equal "declared" (FloatValue 2 0 7) (pred-marginal))
+
+; New Links, and changed Values.
+(store-atom (set-cnt! (edge "b" "c") (FloatValue 1 0 5)))
+(test-equal "new link" (FloatValue 3 0 12) (pred-marginal))
+(store-atom (set-cnt! (edge "a" "b") (FloatValue 1 0 10)))
+(test-equal "changed" (FloatValue 3 0 19) (pred-marginal))
+
+; The Lists are at position 1.
+(test-equal "list" (FloatValue 1 0 10)
+	(cog-rocks-marginal storage (List (Concept "a") (Concept "b")) 'Edge pk 1))
+(test-equal "empty" (FloatValue)
+	(cog-rocks-marginal storage (Concept "a") 'Edge pk 0))
+
+; Removed Links are subtracted.
+(cog-delete-recursive! (Concept "c"))
+(test-equal "removed" (FloatValue 1 0 10) (pred-marginal))
+(cog-close storage)
+
+; The declaration and the sums are kept in the file.
+(cog-atomspace-clear)
+(cog-open storage)
+(test-equal "reopen" (FloatValue 1 0 10) (pred-marginal))
+(store-atom (set-cnt! (edge "a" "d") (FloatValue 1 0 1)))
+(test-equal "reopen store" (FloatValue 2 0 11) (pred-marginal))
+(cog-close storage)
+
+(test-end marginal-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-marginal-test")
+(opencog-test-end)
@@ -0,0 +1,91 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; merge-value-test.scm
+; Verify that, with the `merge-values` option, value updates write
+; only the delta, which is added to whatever is on disk.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-merge-value-test")
+
+(opencog-test-runner)
+
+(define url "rocks:///tmp/cog-rocks-merge-value-test?merge-values")
+(define key (Predicate "counts"))
+
+(define (update ATOM DELTA)
+	(cog-set-value! (RocksStorageNode url) (*-update-value-*)
+		(LinkValue ATOM key DELTA)))
+
+; -------------------------------------------------------------------
+(define merge-test "test merge values")
+(test-begin merge-test)
+
+(cog-open (RocksStorageNode url))
+(store-atom (cog-set-value! (Concept "a") key (FloatValue 1 2 3)))
+
+; Pretend that someone else changed the Value on disk. Only the
+; deltas get written; the local Value is never stored.
+(cog-set-value! (Concept "a") key (FloatValue 9 9 9))
+(update (Concept "a") (FloatValue 0 0 1))
+(update (Concept "a") (FloatValue 0 1 1))
+(cog-close (RocksStorageNode url))
+
+(cog-atomspace-clear)
+(cog-open (RocksStorageNode url))
+(fetch-atom (Concept "a"))
+(test-equal "merged" (FloatValue 1 3 5) (cog-value (Concept "a") key))
+
+; Deltas longer than the Value extend it.
+(update (Concept "a") (FloatValue 0 0 0 2))
+(cog-close (RocksStorageNode url))
+
+(cog-atomspace-clear)
+(cog-open (RocksStorageNode url))
+(fetch-atom (Concept "a"))
+(test-equal "extended" (FloatValue 1 3 5 2) (cog-value (Concept "a") key))
+(cog-close (RocksStorageNode url))
+
+(test-end merge-test)
+
+; -------------------------------------------------------------------
+; Frames in column families created in this session must merge, too.
+(define family-test "test merge values in column families")
+(test-begin family-test)
+
+(whack "/tmp/cog-rocks-merge-family-test")
+(define furl
+	"rocks:///tmp/cog-rocks-merge-family-test?column-families&merge-values")
+
+(define base-space (cog-atomspace))
+(define top-space (AtomSpace base-space))
+(cog-open (RocksStorageNode furl))
+(cog-set-value! (RocksStorageNode furl) (*-store-frames-*) top-space)
+
+(cog-set-atomspace! top-space)
+(store-atom (cog-set-value! (Concept "b") key (FloatValue 1 2 3)))
+(cog-set-value! (Concept "b") key (FloatValue 9 9 9))
+(cog-set-value! (RocksStorageNode furl) (*-update-value-*)
+	(LinkValue (Concept "b") key (FloatValue 0 1 1)))
+(cog-close (RocksStorageNode furl))
+
+(cog-set-atomspace! (AtomSpace))
+(define fstore (RocksStorageNode furl))
+(cog-open fstore)
+(define ftop (cog-value-ref (cog-value fstore (*-load-frames-*)) 0))
+(cog-set-atomspace! ftop)
+(fetch-atom (Concept "b"))
+(cog-close fstore)
+(test-equal "family merged" (FloatValue 1 3 4) (cog-value (Concept "b") key))
+(cog-set-atomspace! base-space)
+
+(test-end family-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-merge-value-test")
+(whack "/tmp/cog-rocks-merge-family-test")
+(opencog-test-end)
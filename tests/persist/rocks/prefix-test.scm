@@ -0,0 +1,56 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; prefix-test.scm
+; Verify that Nodes can be looked up by the start of their names.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-prefix-test")
+
+(opencog-test-runner)
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-prefix-test"))
+
+; -------------------------------------------------------------------
+(define prefix-test "test prefix")
+(test-begin prefix-test)
+
+(cog-open storage)
+(store-atom (set-cnt! (Word "cat") (FloatValue 1 0 3)))
+(store-atom (Word "catalog"))
+(store-atom (Word "category"))
+(store-atom (Word "dog"))
+(store-atom (Word "ca\"t"))
+(store-atom (Concept "cat"))
+(store-atom (Word "cab"))
+(cog-close storage)
+
+(cog-atomspace-clear)
+(cog-open storage)
+(define cats (cog-rocks-nodes-by-prefix storage 'WordNode "cat" 10))
+(test-equal "cats"
+	(list (Word "cat") (Word "catalog") (Word "category")) cats)
+(test-equal "values" 3 (get-cnt (Word "cat")))
+(test-equal "only cats" 3 (cog-count-atoms 'WordNode))
+(test-equal "no concepts" 0 (cog-count-atoms 'ConceptNode))
+
+; The quote is escaped with a backslash, which sorts before letters.
+(test-equal "limit" (list (Word "ca\"t") (Word "cab"))
+	(cog-rocks-nodes-by-prefix storage 'WordNode "ca" 2))
+(test-equal "quoted" (list (Word "ca\"t"))
+	(cog-rocks-nodes-by-prefix storage 'WordNode "ca\"" 10))
+(test-equal "none" '()
+	(cog-rocks-nodes-by-prefix storage 'WordNode "zebra" 10))
+(test-equal "everything" 6
+	(length (cog-rocks-nodes-by-prefix storage 'WordNode "" 100)))
+(cog-close storage)
+
+(test-end prefix-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-prefix-test")
+(opencog-test-end)
@@ -0,0 +1,65 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; remove-atoms-test.scm
+; Verify that many Atoms can be removed from storage at once.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-remove-atoms-test")
+
+(opencog-test-runner)
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-remove-atoms-test"))
+
+; -------------------------------------------------------------------
+(define remove-atoms-test "test remove atoms")
+(test-begin remove-atoms-test)
+
+(cog-open storage)
+(define ab (List (Concept "a") (Concept "b")))
+(define bc (List (Concept "b") (Concept "c")))
+(store-atom (set-cnt! (Edge (Predicate "p") ab) (FloatValue 1 0 3)))
+(store-atom (Edge (Predicate "p") bc))
+(store-atom (set-cnt! (Concept "d") (FloatValue 1 0 4)))
+
+; Not recursive: the List is held by an Edge that stays, and so it
+; stays, as does the Concept it holds. The lone Concept goes.
+(cog-rocks-remove-atoms storage (list ab (Concept "a") (Concept "d")) #f)
+(test-equal "concepts" 3 (cog-rocks-count storage 'Concept))
+(test-equal "lists" 2 (cog-rocks-count storage 'List))
+
+; Not recursive, but everything holding the List goes too.
+(cog-rocks-remove-atoms storage
+	(list ab (Edge (Predicate "p") ab)) #f)
+(test-equal "one edge" 1 (cog-rocks-count storage 'Edge))
+(test-equal "one list" 1 (cog-rocks-count storage 'List))
+(test-equal "a inset" 0 (cog-rocks-incoming-size storage (Concept "a")))
+(test-equal "b inset" 1 (cog-rocks-incoming-size storage (Concept "b")))
+(test-equal "p inset" 1 (cog-rocks-incoming-size storage (Predicate "p")))
+
+; Recursive: the rest of the graph over "b" goes.
+(cog-rocks-remove-atoms storage (list (Concept "b") (Concept "a")) #t)
+(test-equal "no edges" 0 (cog-rocks-count storage 'Edge))
+(test-equal "no lists" 0 (cog-rocks-count storage 'List))
+(test-equal "c left" 1 (cog-rocks-count storage 'Concept))
+(test-equal "c inset" 0 (cog-rocks-incoming-size storage (Concept "c")))
+(test-equal "p no inset" 0 (cog-rocks-incoming-size storage (Predicate "p")))
+(cog-close storage)
+
+(cog-atomspace-clear)
+(cog-open storage)
+(load-atomspace)
+(test-equal "loaded concepts" 1 (cog-count-atoms 'ConceptNode))
+(test-equal "loaded lists" 0 (cog-count-atoms 'ListLink))
+(test-equal "loaded edges" 0 (cog-count-atoms 'EdgeLink))
+(cog-close storage)
+
+(test-end remove-atoms-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-remove-atoms-test")
+(opencog-test-end)
@@ -0,0 +1,171 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; sample-test.scm
+; Verify that random samples of stored Atoms can be loaded.
+;
+(use-modules (srfi srfi-1))
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-sample-test")
+
+(opencog-test-runner)
+
+; -------------------------------------------------------------------
+; Common setup, used by all tests.
+
+(define (setup-and-store)
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-sample-test"))
+	(cog-open storage)
+
+	; Store 100 Concepts, and 100 Lists, each with a count on it.
+	(for-each
+		(lambda (n)
+			(define con (Concept (format #f "thing ~A" n)))
+			(define lst (List con (Concept "other")))
+			(set-cnt! con (FloatValue 1 0 n))
+			(set-cnt! lst (FloatValue 1 0 (+ n 1000)))
+			(store-atom con)
+			(store-atom lst))
+		(iota 100))
+	(cog-close storage)
+)
+
+; -------------------------------------------------------------------
+; Test that samples have the right size, type and values.
+
+(define (test-sample)
+	(setup-and-store)
+
+	; Start with a blank slate.
+	(cog-set-atomspace! (AtomSpace))
+
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-sample-test"))
+	(cog-open storage)
+	(define samp (cog-rocks-sample storage 'ListLink 10 42))
+	(cog-close storage)
+
+	(test-equal "sample-size" 10 (length samp))
+	(test-equal "distinct" 10 (length (delete-duplicates samp)))
+	(test-assert "all-lists"
+		(every (lambda (lst) (equal? 'ListLink (cog-type lst))) samp))
+
+	; Values must have been loaded with the Atoms.
+	(test-assert "all-counts"
+		(every (lambda (lst) (<= 1000 (get-cnt lst))) samp))
+
+	; Only the sampled Lists are in the AtomSpace.
+	(test-equal "list-count" 10 (length (cog-get-atoms 'ListLink)))
+
+	; Asking for more than there are gets all of them.
+	(cog-set-atomspace! (AtomSpace))
+	(cog-open storage)
+	(define all (cog-rocks-sample storage 'ListLink 500 42))
+	(cog-close storage)
+	(test-equal "all-size" 100 (length all))
+
+	; Same seed gives the same sample.
+	(cog-set-atomspace! (AtomSpace))
+	(cog-open storage)
+	(define again (cog-rocks-sample storage 'ListLink 10 42))
+	(cog-close storage)
+	(test-equal "repeatable"
+		(sort (map cog-name (map gar samp)) string<?)
+		(sort (map cog-name (map gar again)) string<?))
+)
+
+(define sample-test "test sample")
+(test-begin sample-test)
+(test-sample)
+(test-end sample-test)
+
+; -------------------------------------------------------------------
+; Two frames on a common base. Only the Atoms that can be seen from
+; the frame being sampled are to be sampled.
+
+(define (setup-frames)
+	(define base-space (AtomSpace "base"))
+	(define left-space (AtomSpace "left" base-space))
+	(define right-space (AtomSpace "right" base-space))
+
+	(cog-set-atomspace! left-space)
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-sample-test"))
+	(cog-open storage)
+	(cog-set-value! storage (*-store-frames-*) left-space)
+	(cog-set-value! storage (*-store-frames-*) right-space)
+
+	(cog-set-atomspace! base-space)
+	(for-each
+		(lambda (n) (store-atom (Concept (format #f "base ~A" n))))
+		(iota 5))
+
+	(cog-set-atomspace! left-space)
+	(for-each
+		(lambda (n) (store-atom (Concept (format #f "left ~A" n))))
+		(iota 40))
+
+	; Two of the base Concepts are deleted in the left frame.
+	(for-each
+		(lambda (n)
+			(define con (Concept (format #f "base ~A" n)))
+			(cog-delete! con)
+			(cog-extract! con))
+		(iota 2))
+
+	; Many more Concepts that cannot be seen from the left frame.
+	(cog-set-atomspace! right-space)
+	(for-each
+		(lambda (n) (store-atom (Concept (format #f "right ~A" n))))
+		(iota 200))
+
+	(cog-close storage)
+)
+
+(define (visible? con)
+	(define name (cog-name con))
+	(and (not (string-prefix? "right" name))
+		(not (equal? "base 0" name))
+		(not (equal? "base 1" name))))
+
+(define (test-sample-frames)
+	(whack "/tmp/cog-rocks-sample-test")
+	(setup-frames)
+
+	; Start with a blank slate.
+	(cog-set-atomspace! (AtomSpace))
+
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-sample-test"))
+	(cog-open storage)
+	(define tops (cog-value->list (cog-value storage (*-load-frames-*))))
+	(define left-space
+		(find (lambda (spc) (equal? "left" (cog-name spc))) tops))
+	(cog-set-atomspace! left-space)
+
+	(define samp (cog-rocks-sample storage 'ConceptNode 10 42))
+	(test-equal "frame-sample-size" 10 (length samp))
+	(test-equal "frame-distinct" 10 (length (delete-duplicates samp)))
+	(test-assert "frame-visible" (every visible? samp))
+
+	; There are 43 that can be seen; asking for all of them, or for
+	; more, gets all of them, and nothing else.
+	(define exact (cog-rocks-sample storage 'ConceptNode 43 42))
+	(test-equal "frame-exact-size" 43 (length exact))
+	(test-assert "frame-exact-visible" (every visible? exact))
+
+	(define all (cog-rocks-sample storage 'ConceptNode 500 42))
+	(test-equal "frame-all-size" 43 (length all))
+	(test-assert "frame-all-visible" (every visible? all))
+	(cog-close storage)
+)
+
+(define sample-frames "test sample frames")
+(test-begin sample-frames)
+(test-sample-frames)
+(test-end sample-frames)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-sample-test")
+(opencog-test-end)
@@ -0,0 +1,113 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; squash-test.scm
+; Verify that merging a stack of frames keeps the visible Values.
+;
+(use-modules (srfi srfi-1))
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-squash-test")
+
+(opencog-test-runner)
+
+; -------------------------------------------------------------------
+; Common setup, used by all tests.
+
+(define (setup-and-store)
+	(define base-space (cog-atomspace))
+	(define mid1-space (AtomSpace base-space))
+	(define mid2-space (AtomSpace mid1-space))
+	(define top-space (AtomSpace mid2-space))
+
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-squash-test"))
+	(cog-open storage)
+	(cog-set-value! storage (*-store-frames-*) top-space)
+
+	(cog-set-atomspace! base-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 3)))
+	(store-atom (set-cnt! (Concept "bar") (FloatValue 1 0 4)))
+	(store-atom (set-cnt! (Concept "qux") (FloatValue 1 0 6)))
+
+	(cog-set-atomspace! mid1-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 33)))
+	(store-atom (set-cnt! (Concept "baz") (FloatValue 1 0 5)))
+
+	(cog-set-atomspace! mid2-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 333)))
+	(cog-delete! (Concept "bar"))
+	(cog-delete! (Concept "qux"))
+
+	(cog-set-atomspace! top-space)
+	(cog-delete! (Concept "baz"))
+	(store-atom (Concept "keyless"))
+
+	; Put back the Atom deleted just below; its Value in the base
+	; frame must stay hidden.
+	(store-atom (Concept "qux"))
+
+	; Merge top, mid2 and mid1.
+	(cog-rocks-squash storage 2)
+
+	; The merged frames are gone; they can't be used any more.
+	(cog-set-atomspace! mid1-space)
+	(test-assert "store-squashed"
+		(catch #t
+			(lambda () (store-atom (Concept "lost")) #f)
+			(lambda (key . args) #t)))
+	(cog-set-atomspace! top-space)
+	(test-assert "fetch-squashed"
+		(catch #t
+			(lambda () (fetch-atom (Concept "foo")) #f)
+			(lambda (key . args) #t)))
+	(cog-close storage)
+	(cog-set-atomspace! base-space)
+)
+
+; -------------------------------------------------------------------
+; Test that the merged frame looks the same as the stack did.
+
+(define (test-squash)
+	(setup-and-store)
+
+	; Start with a blank slate.
+	(cog-set-atomspace! (AtomSpace))
+
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-squash-test"))
+	(cog-open storage)
+	(define top-space (cog-value-ref (cog-value storage (*-load-frames-*)) 0))
+	(cog-set-atomspace! top-space)
+	(cog-set-value! storage (*-load-atomspace-*) (cog-atomspace))
+	(cog-close storage)
+
+	; There are only two frames now.
+	(define base-space (cog-outgoing-atom top-space 0))
+	(test-equal "depth" 0 (cog-arity base-space))
+
+	(test-equal "foo" 333 (get-cnt (cog-node 'Concept "foo")))
+	(test-equal "bar" #f (cog-node 'Concept "bar"))
+	(test-equal "baz" #f (cog-node 'Concept "baz"))
+	(test-assert "keyless" (cog-node 'Concept "keyless"))
+	(test-assert "qux" (cog-node 'Concept "qux"))
+	(test-equal "qux-hidden" #f (cog-value (cog-node 'Concept "qux") pk))
+
+	; The base frame is untouched.
+	(cog-set-atomspace! base-space)
+	(test-equal "base-foo" 3 (get-cnt (cog-node 'Concept "foo")))
+	(test-equal "base-bar" 4 (get-cnt (cog-node 'Concept "bar")))
+	(test-equal "base-qux" 6 (get-cnt (cog-node 'Concept "qux")))
+	(test-equal "base-baz" #f (cog-node 'Concept "baz"))
+	(test-equal "lost" #f (cog-node 'Concept "lost"))
+)
+
+(define squash-test "test squash")
+(test-begin squash-test)
+(test-squash)
+(test-end squash-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-squash-test")
+(opencog-test-end)
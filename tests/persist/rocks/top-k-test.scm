@@ -0,0 +1,65 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; top-k-test.scm
+; Verify that the Atoms with the largest counts can be loaded, without
+; loading anything else.
+;
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-top-k-test")
+
+(opencog-test-runner)
+
+(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-top-k-test"))
+
+(define (store-cnt NAME CNT)
+	(store-atom (set-cnt! (Concept NAME) (FloatValue 1 0 CNT))))
+
+; -------------------------------------------------------------------
+(define top-k-test "test top k")
+(test-begin top-k-test)
+
+(cog-open storage)
+(store-cnt "a" 3)
+(store-cnt "b" 7)
+(store-cnt "c" -2)
+
+; Atoms stored before the declaration are indexed.
+(cog-rocks-declare-order storage pk 2)
+(store-cnt "d" 9)
+(store-cnt "e" 5)
+(store-cnt "f" -8)
+
+; Changed counts move.
+(store-cnt "c" 20)
+(store-cnt "b" 0.5)
+(cog-close storage)
+
+(cog-atomspace-clear)
+(cog-open storage)
+(define top (cog-rocks-load-top storage pk 2 3))
+(test-equal "top three" (list (Concept "c") (Concept "d") (Concept "e")) top)
+(test-equal "top count" 20 (get-cnt (Concept "c")))
+(test-equal "only three" 3 (cog-count-atoms 'ConceptNode))
+
+; Everything, largest first.
+(define all (cog-rocks-load-top storage pk 2 100))
+(test-equal "all" 6 (length all))
+(test-equal "last" (Concept "f") (list-ref all 5))
+(test-equal "next to last" (Concept "b") (list-ref all 4))
+
+; Removed Atoms are gone from the index.
+(cog-delete! (Concept "c"))
+(test-equal "removed" (list (Concept "d"))
+	(cog-rocks-load-top storage pk 2 1))
+(cog-close storage)
+
+(test-end top-k-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-top-k-test")
+(opencog-test-end)
@@ -0,0 +1,109 @@
+#! /usr/bin/env guile
+-s
+!#
+;
+; view-test.scm
+; Verify that fetches from a materialized view of a frame give the
+; same Values as fetches through the frame stack.
+;
+(use-modules (srfi srfi-1))
+(use-modules (opencog) (opencog test-runner))
+(use-modules (opencog persist) (opencog persist-rocks))
+
+(include "test-utils.scm")
+(whack "/tmp/cog-rocks-view-test")
+
+(opencog-test-runner)
+
+; -------------------------------------------------------------------
+; Common setup, used by all tests.
+
+(define (setup-and-store)
+	(define base-space (cog-atomspace))
+	(define mid-space (AtomSpace base-space))
+	(define top-space (AtomSpace mid-space))
+
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-view-test"))
+	(cog-open storage)
+	(cog-set-value! storage (*-store-frames-*) top-space)
+
+	(cog-set-atomspace! base-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 3)))
+	(store-atom (set-cnt! (Concept "bar") (FloatValue 1 0 4)))
+
+	(cog-set-atomspace! mid-space)
+	(store-atom (set-cnt! (Concept "foo") (FloatValue 1 0 33)))
+
+	; Make the view, and then change things underneath it.
+	(cog-set-atomspace! top-space)
+	(cog-rocks-materialize-view storage)
+
+	(cog-set-atomspace! mid-space)
+	(store-atom (set-cnt! (Concept "bar") (FloatValue 1 0 44)))
+	(store-atom (set-cnt! (Concept "baz") (FloatValue 1 0 55)))
+
+	(cog-set-atomspace! top-space)
+	(cog-delete! (Concept "foo"))
+
+	; Changes underneath the visible Values stay hidden.
+	(cog-set-atomspace! base-space)
+	(store-atom (set-cnt! (Concept "bar") (FloatValue 1 0 444)))
+
+	(cog-close storage)
+	(cog-set-atomspace! base-space)
+)
+
+; -------------------------------------------------------------------
+; Test that the view has kept up with the changes.
+
+(define (test-view)
+	(setup-and-store)
+
+	; Start with a blank slate.
+	(cog-set-atomspace! (AtomSpace))
+
+	(define storage (RocksStorageNode "rocks:///tmp/cog-rocks-view-test"))
+	(cog-open storage)
+	(define top-space (cog-value-ref (cog-value storage (*-load-frames-*)) 0))
+	(cog-set-atomspace! top-space)
+	(fetch-atom (Concept "bar"))
+	(fetch-atom (Concept "baz"))
+	(fetch-atom (Concept "foo"))
+
+	(test-equal "bar" 44 (get-cnt (cog-node 'Concept "bar")))
+	(test-equal "baz" 55 (get-cnt (cog-node 'Concept "baz")))
+	(test-equal "foo" #f (cog-node 'Concept "foo"))
+
+	; The Atoms land in the frame holding their Values, just as
+	; they do without the view.
+	(define mid-space (cog-outgoing-atom top-space 0))
+	(test-equal "bar-space" mid-space (cog-atomspace (cog-node 'Concept "bar")))
+	(test-equal "baz-space" mid-space (cog-atomspace (cog-node 'Concept "baz")))
+
+	; The lower frames are still there, as before.
+	(cog-set-atomspace! mid-space)
+	(fetch-atom (Concept "foo"))
+	(test-equal "mid-foo" 33 (get-cnt (cog-node 'Concept "foo")))
+
+	; After the view is dropped, the same answers come back.
+	(cog-set-atomspace! top-space)
+	(cog-rocks-drop-view storage)
+	(cog-close storage)
+
+	(cog-set-atomspace! (AtomSpace))
+	(cog-open storage)
+	(set! top-space (cog-value-ref (cog-value storage (*-load-frames-*)) 0))
+	(cog-set-atomspace! top-space)
+	(fetch-atom (Concept "bar"))
+	(test-equal "bar-again" 44 (get-cnt (cog-node 'Concept "bar")))
+	(cog-close storage)
+)
+
+(define view-test "test view")
+(test-begin view-test)
+(test-view)
+(test-end view-test)
+
+; ===================================================================
+(whack "/tmp/cog-rocks-view-test")
+(opencog-test-end)